@@ -0,0 +1,139 @@
+// Measures the throughput of optparse_parse_batch() in argument vectors per
+// second, for 1 to 8 threads, compared to calling optparse_parse_ctx() for
+// each vector.
+
+#include "bench.h"
+
+#include "optparse99.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define N_JOBS 50000
+#define N_OPTS 16
+#define N_ARGS 8    // The number of options per argument vector.
+#define ARGV_SIZE (1 + 2 * N_ARGS + 1)
+
+static char long_names[N_OPTS][8];
+static char tokens[N_OPTS][12];
+static char numbers[100][4];
+static int flag;
+
+static struct optparse_opt opts[N_OPTS + 1];
+static struct optparse_cmd cmd = { .name = "bench", .options = opts };
+
+static char *argvs[N_JOBS][ARGV_SIZE]; // The original argument vectors.
+static char *work[N_JOBS][ARGV_SIZE];  // Copies, which parsing modifies.
+static struct optparse_value values[N_JOBS][N_OPTS];
+static struct optparse_job jobs[N_JOBS];
+
+// Builds the command's options: flags, integers and strings, alternately.
+static void build_options(void)
+{
+    for (int i = 0; i < N_OPTS; i++) {
+        sprintf(long_names[i], "opt-%c", 'a' + i);
+        sprintf(tokens[i], "--opt-%c", 'a' + i);
+        opts[i] = (struct optparse_opt) { .short_name = 'a' + i,
+            .long_name = long_names[i] };
+        switch (i % 3) {
+            case 0:
+                opts[i].flag = &flag;
+                break;
+            case 1:
+                opts[i].arg_name = "N";
+                opts[i].arg_data_type = DATA_TYPE_INT;
+                break;
+            case 2:
+                opts[i].arg_name = "STRING";
+                break;
+        }
+    }
+    opts[N_OPTS].short_name = END_OF_OPTIONS;
+}
+
+// Builds the argument vectors, each with N_ARGS random options.
+static void build_argvs(void)
+{
+    for (int i = 0; i < 100; i++) {
+        sprintf(numbers[i], "%d", i);
+    }
+    srand(1);
+    for (int i = 0; i < N_JOBS; i++) {
+        char **argv = argvs[i];
+        *argv++ = "bench";
+        for (int j = 0; j < N_ARGS; j++) {
+            int opt = rand() % N_OPTS;
+            if (rand() % 2) {
+                *argv++ = tokens[opt];
+            } else {
+                *argv++ = tokens[opt] + 5; // "-X"
+            }
+            if (opts[opt].arg_name) {
+                *argv++ = numbers[rand() % 100];
+            }
+        }
+        *argv = NULL;
+    }
+}
+
+// Resets the jobs to their original argument vectors.
+static void reset_jobs(void)
+{
+    memcpy(work, argvs, sizeof work);
+    memset(values, 0, sizeof values);
+    for (int i = 0; i < N_JOBS; i++) {
+        int argc = 0;
+        while (work[i][argc]) {
+            argc++;
+        }
+        jobs[i] = (struct optparse_job) { .argc = argc, .argv = work[i],
+            .values = values[i] };
+    }
+}
+
+// Parses all jobs with the given number of threads, or, if n_threads is 0,
+// with one call to optparse_parse_ctx() per job. Returns the fastest run's
+// throughput, in vectors per second.
+static double measure(int n_threads)
+{
+    double best = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        reset_jobs();
+        double start = bench_now();
+        if (n_threads) {
+            if (optparse_parse_batch(&cmd, jobs, N_JOBS, n_threads) != 0) {
+                fprintf(stderr, "Batch parsing failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            for (int i = 0; i < N_JOBS; i++) {
+                struct optparse_ctx ctx = { .values = jobs[i].values };
+                optparse_collect_errors(&ctx, NULL, 0);
+                optparse_parse_ctx(&ctx, &cmd, &jobs[i].argc, &jobs[i].argv);
+            }
+        }
+        double t = bench_now() - start;
+        if (run == 0 || t < best) {
+            best = t;
+        }
+    }
+    return N_JOBS / best;
+}
+
+int main(void)
+{
+    build_options();
+    build_argvs();
+    optparse_compile(&cmd);
+
+    bench_title("Batch parsing (argument vectors per second)");
+    printf("%-24s %12.0f\n", "optparse_parse_ctx()", measure(0));
+    for (int n_threads = 1; n_threads <= 8; n_threads *= 2) {
+        char label[32];
+        sprintf(label, "batch, %d thread%s", n_threads,
+            n_threads > 1 ? "s" : "");
+        printf("%-24s %12.0f\n", label, measure(n_threads));
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+// Helpers shared by the benchmarks. Include this header first.
+
+#ifndef OPTPARSE99_BENCH_H
+#define OPTPARSE99_BENCH_H
+
+#if (defined __unix__ || defined __APPLE__) && !defined _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L // For clock_gettime()
+#endif
+
+#include <stdio.h>
+#include <time.h>
+
+// The number of times a measurement is repeated; the fastest run counts.
+#define BENCH_RUNS 5
+
+// Returns a monotonic time stamp, in seconds.
+static inline double bench_now(void)
+{
+#if defined CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+// Calls fn(arg) n times per run and returns the fastest run's time per call,
+// in nanoseconds.
+static inline double bench_ns(void (*fn)(void *), void *arg, long n)
+{
+    double best = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        double start = bench_now();
+        for (long i = 0; i < n; i++) {
+            fn(arg);
+        }
+        double t = bench_now() - start;
+        if (run == 0 || t < best) {
+            best = t;
+        }
+    }
+    return best * 1e9 / (double) n;
+}
+
+// Prints a benchmark's title, and a warning if assertions are enabled, as they
+// make the parser check the whole command tree on every call.
+static inline void bench_title(const char *title)
+{
+    printf("%s\n", title);
+#ifndef NDEBUG
+    printf("Warning: assertions are enabled; build with NDEBUG (e.g. "
+        "CMAKE_BUILD_TYPE=Release) for meaningful results.\n");
+#endif
+    printf("\n");
+}
+
+#endif
@@ -0,0 +1,140 @@
+// Measures the cost of converting floating-point numbers in lists of 1,000,000
+// items between 0 and 2, written with 6, 9 and 17 significant digits, as a
+// whole list and item by item with strtox(), compared to strtod().
+
+#include "bench.h"
+
+#include "optparse99.h"
+
+#include <errno.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_ITEMS 1000000
+
+static char *list;        // The original list.
+static char *work;        // A copy, which splitting modifies.
+static size_t list_len;
+static char *item_buffer; // The list's items, as separate strings,
+static char **items;      // and pointers to them.
+
+static enum optparse_data_type data_type;
+static volatile double sink; // Keeps results from being discarded.
+
+// Converts the items with strtox().
+static void convert_strtox(void *arg)
+{
+    (void) arg;
+    union optparse_data data;
+    for (int i = 0; i < N_ITEMS; i++) {
+        if (strtox(items[i], &data, data_type) == 0) {
+            sink = data_type == DATA_TYPE_FLT ? data.t_flt : data.t_dbl;
+        }
+    }
+}
+
+// Converts the items the way strtox() did before: with strtod(), followed by
+// end pointer, errno and, for floats, range checks.
+static void convert_strtod(void *arg)
+{
+    (void) arg;
+    for (int i = 0; i < N_ITEMS; i++) {
+        char *end;
+        errno = 0;
+        double result = strtod(items[i], &end);
+        if (data_type == DATA_TYPE_FLT && (result < -FLT_MAX
+                || result > FLT_MAX || (result != 0 && (float) result == 0))) {
+            errno = ERANGE;
+        }
+        if (end != items[i] && *end == '\0' && errno != ERANGE) {
+            sink = data_type == DATA_TYPE_FLT ? (float) result : result;
+        }
+    }
+}
+
+// Parses the list as the option-argument of a list option and returns the
+// fastest run's time per item, in nanoseconds.
+static double measure_list(void)
+{
+    void *array = NULL;
+    size_t size = 0;
+    struct optparse_opt opts[] = {
+        { 'w', .arg_name = "WEIGHTS", .arg_data_type = data_type,
+          .arg_delim = ",", .arg_storage = &array,
+          .arg_storage_size = &size },
+        { .short_name = END_OF_OPTIONS },
+    };
+    struct optparse_cmd cmd = { .name = "bench", .options = opts };
+
+    double best = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        memcpy(work, list, list_len + 1);
+        char *argv[] = { "bench", "-w", work, NULL };
+        int argc = 3;
+        char **av = argv;
+        struct optparse_ctx ctx = { 0 };
+        optparse_collect_errors(&ctx, NULL, 0);
+        double start = bench_now();
+        int ret = optparse_parse_ctx(&ctx, &cmd, &argc, &av);
+        double t = bench_now() - start;
+        if (ret != 0 || size != N_ITEMS) {
+            fprintf(stderr, "Parsing failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        free(array);
+        if (run == 0 || t < best) {
+            best = t;
+        }
+    }
+    optparse_release(&cmd);
+    return best * 1e9 / N_ITEMS;
+}
+
+int main(void)
+{
+    static const char *formats[] = { "%.6f", "%.9g", "%.17g" };
+
+    list = malloc(N_ITEMS * 25);
+    work = malloc(N_ITEMS * 25);
+    item_buffer = malloc(N_ITEMS * 25);
+    items = malloc(N_ITEMS * sizeof *items);
+
+    bench_title("Floating-point conversion (ns per item)");
+    printf("%-6s %-5s %10s %10s %10s\n", "format", "type", "list", "strtox",
+        "strtod");
+    for (size_t f = 0; f < sizeof formats / sizeof formats[0]; f++) {
+        // The list, and its items as separate strings in item_buffer.
+        srand(1);
+        list_len = 0;
+        for (int i = 0; i < N_ITEMS; i++) {
+            if (i) {
+                list[list_len++] = ',';
+            }
+            items[i] = item_buffer + list_len;
+            list_len += sprintf(list + list_len, formats[f],
+                2.0 * rand() / ((double) RAND_MAX + 1));
+        }
+        memcpy(item_buffer, list, list_len + 1);
+        for (char *c = item_buffer; *c; c++) {
+            if (*c == ',') {
+                *c = '\0';
+            }
+        }
+
+        for (int t = 0; t < 2; t++) {
+            data_type = t ? DATA_TYPE_FLT : DATA_TYPE_DBL;
+            double list_ns = measure_list();
+            double strtox_ns = bench_ns(convert_strtox, NULL, 1) / N_ITEMS;
+            double strtod_ns = bench_ns(convert_strtod, NULL, 1) / N_ITEMS;
+            printf("%-6s %-5s %10.1f %10.1f %10.1f\n", formats[f],
+                t ? "FLT" : "DBL", list_ns, strtox_ns, strtod_ns);
+        }
+    }
+
+    free(items);
+    free(item_buffer);
+    free(work);
+    free(list);
+    return 0;
+}
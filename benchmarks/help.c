@@ -0,0 +1,124 @@
+// Measures the time it takes to print the help screen of a command with 1,500
+// options and 100 subcommands, when it is rendered for the first time and when
+// it is printed again from the cache.
+
+#include "bench.h"
+
+#include "optparse99.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define N_OPTS 1500
+#define N_SUBCMDS 100
+#define N_FRESH 20 // The number of times the help screen is rendered anew.
+
+#if defined _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+static FILE *null_stream;
+static struct optparse_ctx cached_ctx; // A context whose command's help screen
+                                       // has been printed before.
+
+// Prints the help screen that has been printed before.
+static void print_cached(void *arg)
+{
+    (void) arg;
+    optparse_fprint_help_ctx(&cached_ctx, null_stream, 0);
+}
+
+// Makes a context's active command the command *cmd, by parsing no arguments.
+static void activate(struct optparse_ctx *ctx, struct optparse_cmd *cmd)
+{
+    char *argv[] = { cmd->name, NULL };
+    int argc = 1;
+    char **av = argv;
+    optparse_collect_errors(ctx, NULL, 0);
+    optparse_parse_ctx(ctx, cmd, &argc, &av);
+}
+
+int main(void)
+{
+    static const char *sentence = "Sets the value this option stands for, "
+        "which is used by the command in ways that take a while to explain. ";
+
+    null_stream = fopen(NULL_DEVICE, "w");
+    if (null_stream == NULL) {
+        perror(NULL_DEVICE);
+        return EXIT_FAILURE;
+    }
+
+    // Options with one to three sentences of description, half of them with
+    // option-arguments, and the first ones with short names.
+    static const char letters[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    struct optparse_opt *opts = calloc(N_OPTS + 1, sizeof *opts);
+    char (*names)[16] = malloc(N_OPTS * sizeof *names);
+    char **descriptions = malloc(N_OPTS * sizeof *descriptions);
+    for (int i = 0; i < N_OPTS; i++) {
+        sprintf(names[i], "option-%d", i);
+        int n_sentences = i % 3 + 1;
+        descriptions[i] = malloc(n_sentences * strlen(sentence) + 1);
+        descriptions[i][0] = '\0';
+        for (int j = 0; j < n_sentences; j++) {
+            strcat(descriptions[i], sentence);
+        }
+        opts[i] = (struct optparse_opt) {
+            .short_name = i < (int) sizeof letters - 1 ? letters[i] : 0,
+            .long_name = names[i], .arg_name = i % 2 ? "VALUE" : NULL,
+            .description = descriptions[i] };
+    }
+    opts[N_OPTS].short_name = END_OF_OPTIONS;
+
+    struct optparse_cmd *subcmds = calloc(N_SUBCMDS + 1, sizeof *subcmds);
+    char (*subcmd_names)[16] = malloc(N_SUBCMDS * sizeof *subcmd_names);
+    for (int i = 0; i < N_SUBCMDS; i++) {
+        sprintf(subcmd_names[i], "command-%d", i);
+        subcmds[i] = (struct optparse_cmd) { .name = subcmd_names[i],
+            .description = (char *) sentence };
+    }
+    subcmds[N_SUBCMDS].name = END_OF_SUBCOMMANDS;
+
+    struct optparse_cmd cmd = { .name = "bench",
+        .about = "bench - a command with a large help screen",
+        .description = (char *) sentence, .operands = "[FILE...]",
+        .options = opts, .subcommands = subcmds };
+
+    bench_title("Help screen with 1,500 options and 100 subcommands (ms)");
+
+    // The command's lookup tables, along with the cached help screen, are
+    // released after each run, so each run renders the help screen again.
+    double first = 0;
+    for (int i = 0; i < N_FRESH; i++) {
+        struct optparse_ctx ctx = { 0 };
+        activate(&ctx, &cmd);
+        double start = bench_now();
+        optparse_fprint_help_ctx(&ctx, null_stream, 0);
+        double t = bench_now() - start;
+        optparse_release(&cmd);
+        if (i == 0 || t < first) {
+            first = t;
+        }
+    }
+    printf("%-16s %10.4f\n", "first render", first * 1e3);
+
+    activate(&cached_ctx, &cmd);
+    optparse_fprint_help_ctx(&cached_ctx, null_stream, 0);
+    printf("%-16s %10.4f\n", "cached", bench_ns(print_cached, NULL, 100)
+        / 1e6);
+
+    optparse_release(&cmd);
+    for (int i = 0; i < N_OPTS; i++) {
+        free(descriptions[i]);
+    }
+    free(descriptions);
+    free(names);
+    free(opts);
+    free(subcmd_names);
+    free(subcmds);
+    fclose(null_stream);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Measures the cost of converting integers with strtox(), for every integer
+// data type, compared to the strtol() family plus range check that strtox()
+// used before it got its own parser.
+
+#include "bench.h"
+
+#include "optparse99.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define N_STRINGS 1000 // The number of converted strings per data type.
+
+struct int_type {
+    enum optparse_data_type data_type;
+    const char *name;
+    long long min;
+    unsigned long long max;
+};
+
+static const struct int_type int_types[] = {
+    { DATA_TYPE_SHRT, "SHRT", SHRT_MIN, SHRT_MAX },
+    { DATA_TYPE_USHRT, "USHRT", 0, USHRT_MAX },
+    { DATA_TYPE_INT, "INT", INT_MIN, INT_MAX },
+    { DATA_TYPE_UINT, "UINT", 0, UINT_MAX },
+    { DATA_TYPE_LONG, "LONG", LONG_MIN, LONG_MAX },
+    { DATA_TYPE_ULONG, "ULONG", 0, ULONG_MAX },
+    { DATA_TYPE_LLONG, "LLONG", LLONG_MIN, LLONG_MAX },
+    { DATA_TYPE_ULLONG, "ULLONG", 0, ULLONG_MAX },
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+    { DATA_TYPE_INT8, "INT8", INT8_MIN, INT8_MAX },
+    { DATA_TYPE_UINT8, "UINT8", 0, UINT8_MAX },
+    { DATA_TYPE_INT16, "INT16", INT16_MIN, INT16_MAX },
+    { DATA_TYPE_UINT16, "UINT16", 0, UINT16_MAX },
+    { DATA_TYPE_INT32, "INT32", INT32_MIN, INT32_MAX },
+    { DATA_TYPE_UINT32, "UINT32", 0, UINT32_MAX },
+    { DATA_TYPE_INT64, "INT64", INT64_MIN, INT64_MAX },
+    { DATA_TYPE_UINT64, "UINT64", 0, UINT64_MAX },
+#endif
+};
+
+struct int_bench {
+    const struct int_type *type;
+    char strings[N_STRINGS][32];
+};
+
+static volatile unsigned long long sink; // Keeps results from being discarded.
+
+// Converts the benchmark's strings with strtox().
+static void convert_strtox(void *arg)
+{
+    struct int_bench *b = arg;
+    union optparse_data data;
+    for (int i = 0; i < N_STRINGS; i++) {
+        if (strtox(b->strings[i], &data, b->type->data_type) == 0) {
+            sink += data.t_uchar;
+        }
+    }
+}
+
+// Converts the benchmark's strings the way strtox() did before: signed types
+// with strtol() or strtoll(), unsigned types with strtoul() or strtoull(),
+// followed by errno, end pointer and range checks.
+static void convert_libc(void *arg)
+{
+    struct int_bench *b = arg;
+    const struct int_type *type = b->type;
+    for (int i = 0; i < N_STRINGS; i++) {
+        const char *str = b->strings[i];
+        char *end;
+        errno = 0;
+        unsigned long long value;
+        if (type->min < 0) {
+            long long result = type->min < LONG_MIN || type->max > LONG_MAX
+                ? strtoll(str, &end, 0) : strtol(str, &end, 0);
+            if (result < type->min || result > (long long) type->max) {
+                errno = ERANGE;
+            }
+            value = (unsigned long long) result;
+        } else {
+            unsigned long long result = type->max > ULONG_MAX
+                ? strtoull(str, &end, 0) : strtoul(str, &end, 0);
+            if (result > type->max) {
+                errno = ERANGE;
+            }
+            value = result;
+        }
+        if (end != str && *end == '\0' && errno != ERANGE) {
+            sink += (unsigned char) value;
+        }
+    }
+}
+
+// Writes random numbers within a type's range to the benchmark's strings:
+// decimal numbers of random length, some of them negative, and hexadecimal
+// numbers.
+static void generate(struct int_bench *b)
+{
+    const struct int_type *type = b->type;
+    int bits = 0;
+    while (bits < 64 && type->max >> bits) {
+        bits++;
+    }
+    for (int i = 0; i < N_STRINGS; i++) {
+        unsigned long long value = 0;
+        for (int j = 0; j < 4; j++) {
+            value = value << 16 | (unsigned long long) (rand() & 0xffff);
+        }
+        value >>= 64 - 1 - rand() % bits; // A random number of bits
+        switch (rand() % 3) {
+            case 0:
+                sprintf(b->strings[i], "%llu", value);
+                break;
+            case 1:
+                sprintf(b->strings[i], "%s%llu", type->min < 0 ? "-" : "",
+                    value);
+                break;
+            case 2:
+                sprintf(b->strings[i], "0x%llx", value);
+                break;
+        }
+    }
+}
+
+int main(void)
+{
+    bench_title("Integer conversion (ns per strtox() call)");
+    printf("%-18s %10s %10s\n", "data type", "strtox", "strtol");
+
+    struct int_bench *b = malloc(sizeof *b);
+    srand(1);
+    for (size_t i = 0; i < sizeof int_types / sizeof int_types[0]; i++) {
+        b->type = &int_types[i];
+        generate(b);
+        double strtox_ns = bench_ns(convert_strtox, b, 2000) / N_STRINGS;
+        double libc_ns = bench_ns(convert_libc, b, 2000) / N_STRINGS;
+        printf("DATA_TYPE_%-8s %10.1f %10.1f\n", b->type->name, strtox_ns,
+            libc_ns);
+    }
+
+    free(b);
+    return 0;
+}
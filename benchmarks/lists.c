@@ -0,0 +1,130 @@
+// Measures the cost of splitting and converting lists of 1,000 to 10,000,000
+// items, as string and as integer lists, compared to the way lists were split
+// before: a counting pass that calls strlen() on the delimiters for every
+// character, strtok(), strtol() for integers, and a shrinking realloc().
+
+#include "bench.h"
+
+#include "optparse99.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *list;  // The original list.
+static char *work;  // A copy, which splitting modifies.
+static size_t list_len;
+
+// Splits a list the way strtoarr() used to, storing the items as strings or,
+// if ints is set, as integers. Returns the number of items.
+static size_t split_strtok(char *string, void **array, const char *delim,
+    int ints)
+{
+    size_t n = 1;
+    for (char *c = string; *c != '\0'; c++) {
+        for (size_t i = 0; i < strlen(delim); i++) {
+            if (*c == delim[i]) {
+                n++;
+                break;
+            }
+        }
+    }
+
+    size_t item_size = ints ? sizeof (int) : sizeof (char *);
+    *array = malloc(n * item_size);
+    n = 0;
+    for (char *item = strtok(string, delim); item; item = strtok(NULL, delim)) {
+        if (ints) {
+            char *end;
+            errno = 0;
+            long value = strtol(item, &end, 0);
+            if (*end != '\0' || errno || value < INT_MIN || value > INT_MAX) {
+                fprintf(stderr, "Invalid list item: %s\n", item);
+                exit(EXIT_FAILURE);
+            }
+            ((int *) *array)[n] = (int) value;
+        } else {
+            ((char **) *array)[n] = item;
+        }
+        n++;
+    }
+    *array = realloc(*array, n * item_size);
+    return n;
+}
+
+// Splits the list with optparse99 or with split_strtok() and returns the
+// fastest run's time per item, in nanoseconds.
+static double measure(size_t n_items, enum optparse_data_type data_type,
+    int use_strtok)
+{
+    void *array = NULL;
+    size_t size = 0;
+    struct optparse_opt opts[] = {
+        { 'l', .arg_name = "LIST", .arg_data_type = data_type,
+          .arg_delim = ",", .arg_storage = &array,
+          .arg_storage_size = &size },
+        { .short_name = END_OF_OPTIONS },
+    };
+    struct optparse_cmd cmd = { .name = "bench", .options = opts };
+
+    double best = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        memcpy(work, list, list_len + 1);
+        double start = bench_now();
+        if (use_strtok) {
+            size = split_strtok(work, &array, ",", data_type == DATA_TYPE_INT);
+        } else {
+            char *argv[] = { "bench", "-l", work, NULL };
+            int argc = 3;
+            char **av = argv;
+            struct optparse_ctx ctx = { 0 };
+            optparse_collect_errors(&ctx, NULL, 0);
+            if (optparse_parse_ctx(&ctx, &cmd, &argc, &av) != 0) {
+                fprintf(stderr, "Parsing failed.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        double t = bench_now() - start;
+        if (size != n_items) {
+            fprintf(stderr, "Expected %zu items, got %zu.\n", n_items, size);
+            exit(EXIT_FAILURE);
+        }
+        free(array);
+        if (run == 0 || t < best) {
+            best = t;
+        }
+    }
+    optparse_release(&cmd);
+    return best * 1e9 / (double) n_items;
+}
+
+int main(void)
+{
+    bench_title("List splitting (ns per item)");
+    printf("%9s %12s %12s %12s %12s\n", "items", "str", "str strtok",
+        "int", "int strtol");
+
+    for (size_t n_items = 1000; n_items <= 10000000; n_items *= 10) {
+        // Random numbers of 1 to 6 digits.
+        list = malloc(n_items * 8);
+        work = malloc(n_items * 8);
+        srand(1);
+        list_len = 0;
+        for (size_t i = 0; i < n_items; i++) {
+            list_len += sprintf(list + list_len, i ? ",%d" : "%d",
+                rand() % 1000000);
+        }
+
+        printf("%9zu %12.1f %12.1f %12.1f %12.1f\n", n_items,
+            measure(n_items, DATA_TYPE_STR, 0),
+            measure(n_items, DATA_TYPE_STR, 1),
+            measure(n_items, DATA_TYPE_INT, 0),
+            measure(n_items, DATA_TYPE_INT, 1));
+
+        free(work);
+        free(list);
+    }
+
+    return 0;
+}
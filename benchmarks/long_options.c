@@ -0,0 +1,86 @@
+// Measures the cost of looking up long options in commands with 10 to 10,000
+// options, compared to a linear search with strcmp(), which is how options
+// were found before commands had lookup tables.
+
+#include "bench.h"
+
+#include "optparse99.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define N_TOKENS 1000 // The number of options per parsed argument vector.
+
+struct lookup_bench {
+    struct optparse_cmd *cmd;
+    char *argv[N_TOKENS + 2];
+    char *work[N_TOKENS + 2];
+};
+
+// Parses the benchmark's argument vector once.
+static void parse_tokens(void *arg)
+{
+    struct lookup_bench *b = arg;
+    memcpy(b->work, b->argv, sizeof b->work);
+    int argc = N_TOKENS + 1;
+    char **argv = b->work;
+    struct optparse_ctx ctx = { 0 };
+    optparse_collect_errors(&ctx, NULL, 0);
+    optparse_parse_ctx(&ctx, b->cmd, &argc, &argv);
+}
+
+static volatile char found; // Keeps the linear search from being optimized out.
+
+// Looks up the benchmark's options with a linear search.
+static void scan_tokens(void *arg)
+{
+    struct lookup_bench *b = arg;
+    for (int i = 1; i <= N_TOKENS; i++) {
+        const char *name = b->argv[i] + 2;
+        struct optparse_opt *opt = b->cmd->options;
+        while (strcmp(opt->long_name, name) != 0) {
+            opt++;
+        }
+        found = opt->short_name;
+    }
+}
+
+int main(void)
+{
+    bench_title("Long option lookup (ns per --option)");
+    printf("%8s %12s %12s\n", "options", "optparse99", "strcmp scan");
+
+    static int flag;
+    for (int n_opts = 10; n_opts <= 10000; n_opts *= 10) {
+        struct optparse_opt *opts = calloc(n_opts + 1, sizeof *opts);
+        char (*names)[16] = malloc(n_opts * sizeof *names);
+        for (int i = 0; i < n_opts; i++) {
+            sprintf(names[i], "option-%d", i);
+            opts[i] = (struct optparse_opt) { .long_name = names[i],
+                .flag = &flag, .flag_type = FLAG_TYPE_INCREMENT };
+        }
+        opts[n_opts].short_name = END_OF_OPTIONS;
+        struct optparse_cmd cmd = { .name = "bench", .options = opts };
+        optparse_compile(&cmd);
+
+        struct lookup_bench b = { .cmd = &cmd };
+        char (*tokens)[20] = malloc(N_TOKENS * sizeof *tokens);
+        srand(n_opts);
+        b.argv[0] = "bench";
+        for (int i = 0; i < N_TOKENS; i++) {
+            sprintf(tokens[i], "--%s", names[rand() % n_opts]);
+            b.argv[i + 1] = tokens[i];
+        }
+
+        double parse_ns = bench_ns(parse_tokens, &b, 200) / N_TOKENS;
+        double scan_ns = bench_ns(scan_tokens, &b, 20) / N_TOKENS;
+        printf("%8d %12.1f %12.1f\n", n_opts, parse_ns, scan_ns);
+
+        optparse_release(&cmd);
+        free(tokens);
+        free(names);
+        free(opts);
+    }
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Measures the cost of dispatching subcommands in wide trees (one level with
+// 10 to 10,000 subcommands) and deep trees (20 subcommands per command, 1 to 4
+// levels deep), compared to a linear search with strcmp() at every level,
+// which is how subcommands were found before commands had lookup tables.
+
+#include "bench.h"
+
+#include "optparse99.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define N_PATHS 1000 // The number of parsed subcommand chains.
+#define MAX_DEPTH 4
+
+struct dispatch_bench {
+    struct optparse_cmd *root;
+    int depth;
+    char *paths[N_PATHS][MAX_DEPTH + 2]; // "bench", names..., NULL
+};
+
+static char (*names)[16]; // The subcommands' names, shared by all levels.
+
+// Builds a level of a tree of subcommands.
+static struct optparse_cmd *build_level(int fanout, int depth)
+{
+    struct optparse_cmd *cmds = calloc(fanout + 1, sizeof *cmds);
+    for (int i = 0; i < fanout; i++) {
+        cmds[i].name = names[i];
+        if (depth > 1) {
+            cmds[i].subcommands = build_level(fanout, depth - 1);
+        }
+    }
+    cmds[fanout].name = END_OF_SUBCOMMANDS;
+    return cmds;
+}
+
+// Frees a level of a tree of subcommands.
+static void free_level(struct optparse_cmd *cmds)
+{
+    for (struct optparse_cmd *cmd = cmds; cmd->name; cmd++) {
+        if (cmd->subcommands) {
+            free_level(cmd->subcommands);
+        }
+    }
+    free(cmds);
+}
+
+// Parses each of the benchmark's subcommand chains.
+static void parse_paths(void *arg)
+{
+    struct dispatch_bench *b = arg;
+    for (int i = 0; i < N_PATHS; i++) {
+        char *work[MAX_DEPTH + 2];
+        memcpy(work, b->paths[i], sizeof work);
+        int argc = b->depth + 1;
+        char **argv = work;
+        struct optparse_ctx ctx = { 0 };
+        optparse_collect_errors(&ctx, NULL, 0);
+        optparse_parse_ctx(&ctx, b->root, &argc, &argv);
+    }
+}
+
+// Keeps the linear search from being optimized out.
+static char *volatile found;
+
+// Finds each of the benchmark's subcommand chains with a linear search.
+static void scan_paths(void *arg)
+{
+    struct dispatch_bench *b = arg;
+    for (int i = 0; i < N_PATHS; i++) {
+        struct optparse_cmd *cmd = b->root;
+        for (char **name = b->paths[i] + 1; *name; name++) {
+            cmd = cmd->subcommands;
+            while (strcmp(cmd->name, *name) != 0) {
+                cmd++;
+            }
+        }
+        found = cmd->name;
+    }
+}
+
+// Measures dispatching in a tree of the given shape and prints the results.
+static void run(int fanout, int depth)
+{
+    struct optparse_cmd root = { .name = "bench",
+        .subcommands = build_level(fanout, depth) };
+    optparse_compile(&root);
+
+    struct dispatch_bench *b = calloc(1, sizeof *b);
+    b->root = &root;
+    b->depth = depth;
+    srand(fanout * MAX_DEPTH + depth);
+    for (int i = 0; i < N_PATHS; i++) {
+        b->paths[i][0] = "bench";
+        for (int level = 1; level <= depth; level++) {
+            b->paths[i][level] = names[rand() % fanout];
+        }
+    }
+
+    double parse_ns = bench_ns(parse_paths, b, 50) / N_PATHS;
+    double scan_ns = bench_ns(scan_paths, b, 5) / N_PATHS;
+    printf("%8d %6d %12.1f %12.1f\n", fanout, depth, parse_ns, scan_ns);
+
+    free(b);
+    optparse_release(&root);
+    free_level(root.subcommands);
+}
+
+int main(void)
+{
+    names = malloc(10000 * sizeof *names);
+    for (int i = 0; i < 10000; i++) {
+        sprintf(names[i], "command-%d", i);
+    }
+
+    bench_title("Subcommand dispatch (ns per parsed chain)");
+    printf("%8s %6s %12s %12s\n", "fanout", "depth", "optparse99",
+        "strcmp scan");
+    for (int fanout = 10; fanout <= 10000; fanout *= 10) {
+        run(fanout, 1);
+    }
+    for (int depth = 2; depth <= MAX_DEPTH; depth++) {
+        run(20, depth);
+    }
+
+    free(names);
+    return 0;
+}
@@ -38,39 +38,371 @@ SOFTWARE.
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
-#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
 #include <stdint.h>
-#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if OPTPARSE_BATCH_THREADS
+#include <pthread.h>
+#endif
+#if (OPTPARSE_LIST_SUPPORT && OPTPARSE_LIST_FILES || OPTPARSE_RESPONSE_FILES \
+    || OPTPARSE_CONFIG_FILES) && (defined __unix__ || defined __APPLE__)
+#define USE_MMAP true
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if OPTPARSE_LIST_SUPPORT && defined __GNUC__
+#if defined __AVX2__
+#include <immintrin.h>
+#elif defined __SSE2__
+#include <emmintrin.h>
+#endif
+#endif
 
-// Global variables
-static struct optparse_cmd *optparse_main_cmd; // The command tree's root.
-static char **args; // Contains the current state of argv while parsing.
-static int args_index; // Keeps track of the currently parsed argument's index.
+#if OPTPARSE_ENV_VARIABLES
+#if defined __APPLE__
+#include <crt_externs.h>
+#define environ (*_NSGetEnviron())
+#else
+extern char **environ;
+#endif
+#endif
+
+// Storage-class specifier for variables that exist once per thread.
+#if defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL _Thread_local
+#elif defined __GNUC__
+#define THREAD_LOCAL __thread
+#elif defined _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL
+#endif
+
+#if (OPTPARSE_LONG_OPTIONS && !OPTPARSE_GENERATED_PARSER) \
+    || OPTPARSE_SUBCOMMANDS || OPTPARSE_ENV_VARIABLES
+#define USE_HASH_TABLES true // Names are looked up in hash tables.
+#endif
+
+#if OPTPARSE_FLOATING_POINT_SUPPORT && defined FLT_EVAL_METHOD \
+    && FLT_EVAL_METHOD == 0
+// Floating-point numbers are converted by strtofp_fast() where possible, which
+// excess precision would make round intermediate results twice.
+#define USE_FAST_FLOATS true
+#endif
+
+#if USE_HASH_TABLES
+// An entry of an open-addressing hash table that maps names to items.
+struct optparse_slot {
+    size_t hash;
+    char *name; // NULL if the slot is empty.
+    void *item;
+};
+#endif
+
+#if OPTPARSE_COMPILED_TREES
+// The layout of a compiled tree (see optparse_compile_tree()), which begins
+// with a header of 32-bit unsigned integers in native byte order. Offsets count
+// bytes from the compiled tree's start. Integers are read with memcpy(), so no
+// particular alignment is required.
+enum compiled_tree_header {
+    TREE_MAGIC,        // COMPILED_TREE_MAGIC
+    TREE_SIZE,         // The compiled tree's size.
+    TREE_N_CMDS,       // The number of commands.
+    TREE_N_OPTS,       // The number of options.
+    TREE_CMDS,         // Offset of the commands' records (see TREE_CMD_*),
+                       // which are numbered depth-first.
+    TREE_HASHES,       // Offset of the options' long name hash values (32-bit
+                       // FNV-1a), which are numbered depth-first.
+    TREE_NAME_OFFSETS, // Offset of the options' long name offsets in the pool.
+    TREE_NAME_LENS,    // Offset of the options' long name lengths.
+    TREE_SLOTS,        // Offset of the commands' long option tables, whose
+                       // slots hold a command's option number + 1, or 0.
+    TREE_SHORT_NAMES,  // Offset of the options' short names (1 byte each).
+    TREE_TYPES,        // Offset of the options' .arg_data_type (1 byte each).
+    TREE_TRAITS,       // Offset of the options' traits (1 byte each, see
+                       // get_traits()).
+    TREE_POOL,         // Offset of the long names, without terminators.
+    TREE_HEADER_LEN
+};
+
+// A command's record in a compiled tree, as 32-bit unsigned integers.
+enum compiled_tree_cmd {
+    TREE_CMD_FIRST_OPT,  // The number of the command's first option.
+    TREE_CMD_N_OPTS,     // The number of options the command has.
+    TREE_CMD_SLOTS,      // The number of the long option table's first slot.
+    TREE_CMD_SLOTS_MASK, // The long option table's size - 1.
+    TREE_CMD_LEN
+};
+
+#define COMPILED_TREE_MAGIC 0x6f703939 // "op99" in big-endian byte order
+
+// A command's part of a loaded compiled tree.
+struct compiled_cmd {
+    const unsigned char *slots;        // NULL if no compiled tree is loaded.
+    const unsigned char *hashes;       // 32-bit arrays, as described in
+    const unsigned char *name_offsets; // compiled_tree_header.
+    const unsigned char *name_lens;
+    const char *pool;
+    size_t slots_mask;
+};
+#endif
+
+#if !OPTPARSE_HELP_PRERENDERED
+// A command's rendered help screen, as cached in its index.
+struct rendered_help {
+    size_t len;
+    size_t about_len;                // The length of the "about" part.
+    char data[];
+};
+#endif
+
+// Contains a command's lookup tables.
+struct optparse_index {
+    int first_opt_id;                // The tree-wide id of the command's first
+                                     // option (see get_option_id()).
+#if OPTPARSE_GENERATED_PARSER
+    const struct optparse_generated_cmd *generated;
+                                     // The command's entry in
+                                     // optparse_generated_parser[].
+#else
+    struct optparse_opt *short_opts[UCHAR_MAX + 1];
+                                     // The command's short options, indexed by
+                                     // their (unsigned) short name.
+#if OPTPARSE_LONG_OPTIONS
+    size_t long_opts_mask;           // The long option table's size - 1.
+    struct optparse_slot *long_opts; // The command's long options.
+#endif
+#endif
+#if OPTPARSE_COMPILED_TREES
+    struct compiled_cmd compiled;    // Replaces the option tables, if a
+                                     // compiled tree is loaded.
+#endif
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    int max_group;                   // The largest group value in the
+                                     // command's subtree.
+#endif
 #if OPTPARSE_SUBCOMMANDS
-static struct optparse_cmd *active_cmd; // Keeps track of the currently running
-                                        // command.
-static int subcmd_depth; // The command tree's depth (automatically calculated).
+    size_t subcmds_mask;             // The subcommand table's size - 1.
+    struct optparse_slot *subcmds;   // The command's subcommands.
+#endif
+#if !OPTPARSE_HELP_PRERENDERED
+    struct rendered_help *help;      // The command's rendered help screen;
+                                     // NULL until it's first printed. Set
+                                     // only once (see cache_help()).
+#endif
+#if OPTPARSE_ENV_VARIABLES
+    size_t env_opts_mask;            // The environment variable table's size -
+                                     // 1.
+    struct optparse_slot *env_opts;  // The command's options, by their
+                                     // .env_name; NULL if there are none.
+#endif
+};
+
+// Global variables
+static struct optparse_ctx default_ctx; // The context used by optparse_parse().
+static THREAD_LOCAL struct optparse_ctx *current_ctx; // The context that is
+                                                      // being parsed on the
+                                                      // calling thread.
+#if OPTPARSE_BATCH_THREADS && !OPTPARSE_HELP_PRERENDERED && !OPTPARSE_NO_HEAP \
+    && !defined __GNUC__
+// Guards the help screens cached in command indexes, where atomic operations
+// are not available.
+static pthread_mutex_t help_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
-static FILE *help_stream; // The stream help information is printed to.
 
 /// Private functions ----------------------------------------------------------
 
-// Prints an error message and quits. Should be used for parsing errors only.
-static void optparse_error(char *fmt, ...)
+// Returns the context that is being parsed on the calling thread or, if there
+// is none, the default context.
+static struct optparse_ctx *get_ctx(void)
 {
-    va_list ap;
-    va_start(ap, fmt);
-    vfprintf(stderr, fmt, ap);
-    va_end(ap);
+    return current_ctx ? current_ctx : &default_ctx;
+}
+
+// Allocates memory with the context's allocator, without tracking it.
+static void *raw_malloc(struct optparse_ctx *ctx, size_t size)
+{
+    if (ctx->allocator.alloc) {
+        return ctx->allocator.alloc(size, ctx->allocator.user_data);
+    }
+#if OPTPARSE_NO_HEAP
+    return NULL;
+#else
+    return malloc(size);
+#endif
+}
+
+// Resizes memory with the context's allocator, without tracking it.
+static void *raw_realloc(struct optparse_ctx *ctx, void *ptr, size_t size)
+{
+    if (ctx->allocator.alloc) {
+        return ctx->allocator.realloc(ptr, size, ctx->allocator.user_data);
+    }
+#if OPTPARSE_NO_HEAP
+    return NULL;
+#else
+    return realloc(ptr, size);
+#endif
+}
+
+// Frees memory with the context's allocator, without tracking it.
+static void raw_free(struct optparse_ctx *ctx, void *ptr)
+{
+    if (ctx->allocator.alloc) {
+        if (ptr) {
+            ctx->allocator.free(ptr, ctx->allocator.user_data);
+        }
+        return;
+    }
+#if !OPTPARSE_NO_HEAP
+    free(ptr);
+#endif
+}
+
+// Adds memory to the context's tracked allocations.
+// Return value: 0 on success, -1 if memory could not be allocated
+static int track(struct optparse_ctx *ctx, void *ptr)
+{
+    if (ctx->n_allocations == ctx->allocations_capacity) {
+        size_t capacity = ctx->allocations_capacity
+            ? ctx->allocations_capacity * 2 : 16;
+        void **ret = raw_realloc(ctx, ctx->allocations,
+            capacity * sizeof *ret);
+        if (ret == NULL) {
+            return -1;
+        }
+        ctx->allocations = ret;
+        ctx->allocations_capacity = capacity;
+    }
+    ctx->allocations[ctx->n_allocations++] = ptr;
+    return 0;
+}
+
+// Returns the position of memory in the context's tracked allocations, or
+// their number if it is not tracked. Recent allocations, which are most likely
+// to be resized or freed, are found first.
+static size_t find_tracked(struct optparse_ctx *ctx, void *ptr)
+{
+    for (size_t i = ctx->n_allocations; i > 0; i--) {
+        if (ctx->allocations[i - 1] == ptr) {
+            return i - 1;
+        }
+    }
+    return ctx->n_allocations;
+}
+
+// Allocates memory with the context's allocator.
+static void *ctx_malloc(struct optparse_ctx *ctx, size_t size)
+{
+    void *ptr = raw_malloc(ctx, size);
+    if (ptr && ctx->track_allocations && track(ctx, ptr)) {
+        raw_free(ctx, ptr);
+        return NULL;
+    }
+    return ptr;
+}
+
+#if OPTPARSE_LIST_SUPPORT || OPTPARSE_RESPONSE_FILES \
+    || (OPTPARSE_CONFIG_FILES && OPTPARSE_LONG_OPTIONS)
+// Resizes memory with the context's allocator.
+static void *ctx_realloc(struct optparse_ctx *ctx, void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return ctx_malloc(ctx, size);
+    }
+    void *ret = raw_realloc(ctx, ptr, size);
+    if (ret) {
+        size_t i = find_tracked(ctx, ptr);
+        if (i < ctx->n_allocations) {
+            ctx->allocations[i] = ret;
+        }
+    }
+    return ret;
+}
+#endif
+
+// Frees memory with the context's allocator.
+static void ctx_free(struct optparse_ctx *ctx, void *ptr)
+{
+    size_t i = find_tracked(ctx, ptr);
+    if (ptr && i < ctx->n_allocations) {
+        ctx->allocations[i] = ctx->allocations[--ctx->n_allocations];
+    }
+    raw_free(ctx, ptr);
+}
+
+// Returns an option's position in the command tree, counting depth-first.
+// The command's lookup tables must exist.
+static int get_option_id(struct optparse_cmd *cmd, struct optparse_opt *opt)
+{
+    return cmd->_index->first_opt_id + (int) (opt - cmd->options);
+}
+
+// Returns the number of options a command has, not counting its subcommands'
+// options.
+static int count_own_options(struct optparse_cmd *cmd)
+{
+    int n = 0;
+    if (cmd->options) {
+        while (cmd->options[n].short_name != (char) END_OF_OPTIONS) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// Quits with the specified exit status or, if the context collects errors,
+// stops parsing.
+static void quit(struct optparse_ctx *ctx, int exit_status)
+{
+    if (ctx->collect_errors) {
+        ctx->stopped = true;
+    } else {
+        exit(exit_status);
+    }
+}
+
+// Reports a parsing error. If the error's .arg is not set, the currently parsed
+// argument is used. Prints the error message and quits, unless the context
+// collects errors.
+static void report_error(struct optparse_ctx *ctx, struct optparse_error error)
+{
+#if OPTPARSE_CONFIG_FILES
+    if (error.arg == NULL && ctx->config_path) {
+        error.index = ctx->config_line;
+        error.arg = ctx->config_path;
+    }
+#endif
+#if OPTPARSE_ENV_VARIABLES
+    if (error.arg == NULL && ctx->env_var) {
+        error.index = -1;
+        error.arg = ctx->env_var;
+    }
+#endif
+    if (error.arg == NULL && ctx->args) {
+        error.index = ctx->args_offset + ctx->args_index;
+        error.arg = ctx->args[ctx->args_index];
+    }
+
+    if (ctx->collect_errors) {
+        if (ctx->n_errors < ctx->errors_max) {
+            ctx->errors[ctx->n_errors] = error;
+        }
+        ctx->n_errors++;
+        return;
+    }
+
+    optparse_fprint_error(stderr, &error);
 #if OPTPARSE_PRINT_HELP_ON_ERROR
-    optparse_fprint_help(stderr, EXIT_FAILURE);
+    optparse_fprint_help_ctx(ctx, stderr, EXIT_FAILURE);
 #endif
     exit(EXIT_FAILURE);
 }
 
+#if !OPTPARSE_HELP_PRERENDERED || OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
 // Safely prints to a buffer of size OPTPARSE_PRINT_BUFFER_SIZE;
 static int bprintf(char *buffer, const char *fmt, ...)
 {
@@ -82,8 +414,9 @@ static int bprintf(char *buffer, const char *fmt, ...)
     va_end(ap);
     return n;
 }
+#endif
 
-#if OPTPARSE_HELP_USAGE_STYLE == 1
+#if OPTPARSE_HELP_USAGE_STYLE == 1 && !OPTPARSE_HELP_PRERENDERED
 // Prints an option's usage information ("-a ARG") to a buffer.
 static void bprint_option_usage(char *buffer, struct optparse_opt *opt)
 {
@@ -123,6 +456,9 @@ static int get_data_type_size(enum optparse_data_type data_type)
         case DATA_TYPE_SCHAR:
         case DATA_TYPE_UCHAR:
             return 1;
+        case DATA_TYPE_SHRT:
+        case DATA_TYPE_USHRT:
+            return sizeof (short);
         case DATA_TYPE_INT:
         case DATA_TYPE_UINT:
             return sizeof (int);
@@ -161,1279 +497,5199 @@ static int get_data_type_size(enum optparse_data_type data_type)
     }
 }
 
-#if OPTPARSE_LIST_SUPPORT
-// Converts a non-literal string that has the form of a list into an array of
-// specified data type. The string will be altered and cannot be used anymore in
-// its original form. The array's data type must match the specified data type.
-// If the list contains items, the array's memory will be dynamically
-// allocated - free() should be called if the memory is no longer needed.
-// To avoid compiler warnings, the array pointer can be explicitly cast to
-// void *: "strtoarr(..., (void *) &array, ...);".
-// Return value: the number of list items stored in the array.
-static size_t strtoarr(char *string, void **array, char *delim,
-    enum optparse_data_type data_type)
+// Gets the range of an integer data type.
+// Return value: 1 if the data type is supported, otherwise 0
+static int get_int_range(enum optparse_data_type data_type, long long *min,
+    unsigned long long *max)
 {
-    if (string == NULL || delim == NULL) {
-        *array = NULL;
-        return 0;
+    *min = 0;
+    switch (data_type) {
+        case DATA_TYPE_SHRT:
+            *min = SHRT_MIN;
+            *max = SHRT_MAX;
+            return 1;
+        case DATA_TYPE_USHRT:
+            *max = USHRT_MAX;
+            return 1;
+        case DATA_TYPE_INT:
+            *min = INT_MIN;
+            *max = INT_MAX;
+            return 1;
+        case DATA_TYPE_UINT:
+            *max = UINT_MAX;
+            return 1;
+        case DATA_TYPE_LONG:
+            *min = LONG_MIN;
+            *max = LONG_MAX;
+            return 1;
+        case DATA_TYPE_ULONG:
+            *max = ULONG_MAX;
+            return 1;
+        case DATA_TYPE_LLONG:
+            *min = LLONG_MIN;
+            *max = LLONG_MAX;
+            return 1;
+        case DATA_TYPE_ULLONG:
+            *max = ULLONG_MAX;
+            return 1;
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+        case DATA_TYPE_INT8:
+            *min = INT8_MIN;
+            *max = INT8_MAX;
+            return 1;
+        case DATA_TYPE_UINT8:
+            *max = UINT8_MAX;
+            return 1;
+        case DATA_TYPE_INT16:
+            *min = INT16_MIN;
+            *max = INT16_MAX;
+            return 1;
+        case DATA_TYPE_UINT16:
+            *max = UINT16_MAX;
+            return 1;
+        case DATA_TYPE_INT32:
+            *min = INT32_MIN;
+            *max = INT32_MAX;
+            return 1;
+        case DATA_TYPE_UINT32:
+            *max = UINT32_MAX;
+            return 1;
+        case DATA_TYPE_INT64:
+            *min = INT64_MIN;
+            *max = INT64_MAX;
+            return 1;
+        case DATA_TYPE_UINT64:
+            *max = UINT64_MAX;
+            return 1;
+#endif
+        default:
+            return 0;
     }
+}
 
-    // Get temporary array size.
-    size_t array_size = 1;
-    char *c = string;
-    while (*c != '\0') {
-        for (size_t i = 0; i < strlen(delim); i++) {
-            if (*c == delim[i]) {
-                array_size++;
-                break;
-            }
-        }
-        c++;
+// Stores an integer of the specified data type. The value must be within the
+// data type's range.
+// negative: the value's sign; value holds its magnitude
+// Return value: 0 on success, 1 if the data type is not an integer type
+static int store_int(void *x, enum optparse_data_type data_type,
+    unsigned long long value, _Bool negative)
+{
+    // Negate without overflowing if value is -LLONG_MIN.
+    long long s = negative && value ? -(long long) (value - 1) - 1
+        : (long long) value;
+    switch (data_type) {
+        case DATA_TYPE_SHRT:
+            *(short *) x = (short) s;
+            break;
+        case DATA_TYPE_USHRT:
+            *(unsigned short *) x = (unsigned short) value;
+            break;
+        case DATA_TYPE_INT:
+            *(int *) x = (int) s;
+            break;
+        case DATA_TYPE_UINT:
+            *(unsigned int *) x = (unsigned int) value;
+            break;
+        case DATA_TYPE_LONG:
+            *(long *) x = (long) s;
+            break;
+        case DATA_TYPE_ULONG:
+            *(unsigned long *) x = (unsigned long) value;
+            break;
+        case DATA_TYPE_LLONG:
+            *(long long *) x = s;
+            break;
+        case DATA_TYPE_ULLONG:
+            *(unsigned long long *) x = value;
+            break;
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+        case DATA_TYPE_INT8:
+            *(int8_t *) x = (int8_t) s;
+            break;
+        case DATA_TYPE_UINT8:
+            *(uint8_t *) x = (uint8_t) value;
+            break;
+        case DATA_TYPE_INT16:
+            *(int16_t *) x = (int16_t) s;
+            break;
+        case DATA_TYPE_UINT16:
+            *(uint16_t *) x = (uint16_t) value;
+            break;
+        case DATA_TYPE_INT32:
+            *(int32_t *) x = (int32_t) s;
+            break;
+        case DATA_TYPE_UINT32:
+            *(uint32_t *) x = (uint32_t) value;
+            break;
+        case DATA_TYPE_INT64:
+            *(int64_t *) x = (int64_t) s;
+            break;
+        case DATA_TYPE_UINT64:
+            *(uint64_t *) x = (uint64_t) value;
+            break;
+#endif
+        default:
+            return 1;
     }
 
-    int data_type_size = get_data_type_size(data_type);
+    return 0;
+}
+
+// Gets the value of a digit in bases up to 36.
+// Return value: the digit's value, or 36 if c is not a digit
+static unsigned digit_value(unsigned char c)
+{
+    if ((unsigned) (c - '0') < 10) {
+        return c - '0';
+    }
+    c |= 0x20; // Lowercase
+    if ((unsigned) (c - 'a') < 26) {
+        return c - 'a' + 10;
+    }
+    return 36;
+}
 
-    // Allocate temporary array size.
-    *array = malloc(array_size * data_type_size);
-    if (*array == NULL) {
-        optparse_error("Out of memory.\n");
+// Converts a string to an integer of the specified data type without the
+// overhead of strtol() and friends, i.e. without locale lookups and errno.
+// The same notations are accepted as by strtol() with base 0 in the "C" locale:
+// leading whitespace, an optional sign, and a decimal, hexadecimal ("0x") or
+// octal ("0") number. As with strtoul(), negative numbers are wrapped around
+// for unsigned data types, and are only in range if the wrapped value is.
+// min, max: the data type's range (see get_int_range())
+// Return value: same as strtox()
+static int strtoint(const char *str, void *x, enum optparse_data_type data_type,
+    long long min, unsigned long long max)
+{
+    const unsigned char *p = (const unsigned char *) str;
+    while (*p == ' ' || (unsigned) (*p - '\t') < 5) {
+        p++;
+    }
+    _Bool negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        p++;
     }
 
-    // Convert list items to specified data type and store them in the array.
-    array_size = 0;
-    char *list_item = strtok(string, delim);
-    while (list_item != NULL) {
-        int ret = strtox(list_item, ((char *) *array) + array_size
-            * data_type_size, data_type);
-        if (ret) {
-            free(*array);
-            if (ret == 1) {
-                optparse_error("List item not valid: \"%s\"\n", list_item);
-            } else if (ret == -1) {
-                optparse_error("List item out of range: \"%s\"\n", list_item);
-            }
+    unsigned base = 10;
+    if (p[0] == '0') {
+        if ((p[1] | 0x20) == 'x' && digit_value(p[2]) < 16) {
+            base = 16;
+            p += 2;
+        } else {
+            base = 8;
         }
-
-        array_size++;
-        list_item = strtok(NULL, delim);
     }
 
-    // Allocate final array size.
-    void *ret = realloc(*array, array_size * data_type_size);
-    if (ret == NULL && array_size != 0) {
-        free(*array);
-        optparse_error("Out of memory.\n");
+    // The largest magnitude that is in range. For unsigned data types, that's
+    // the range of strtoul() or strtoull(), whichever is used for the type.
+    unsigned long long limit;
+    if (min < 0) {
+        limit = negative ? (unsigned long long) -(min + 1) + 1 : max;
     } else {
-        *array = ret;
+        limit = max > ULONG_MAX ? ULLONG_MAX : ULONG_MAX;
     }
 
-    return array_size;
-}
-#endif
-
-// Executes an option structure's tasks.
-// arg: the option's option-argument; NULL if none provided by the user.
-static void execute_option(struct optparse_opt *opt, char *arg)
-{
-    union {
-        char t_char;
-        signed char t_schar;
-        unsigned char t_uchar;
-        short t_shrt;
-        unsigned short t_ushrt;
-        int t_int;
-        unsigned int t_uint;
-        long t_long;
-        unsigned long t_ulong;
-        long long t_llong;
-        unsigned long long t_ullong;
-#if OPTPARSE_FLOATING_POINT_SUPPORT
-        float t_flt;
-        double t_dbl;
-        long double t_ldbl;
-#endif
-        _Bool t_bool;
-#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
-        int8_t t_int8;
-        uint8_t t_uint8;
-        int16_t t_int16;
-        uint16_t t_uint16;
-        int32_t t_int32;
-        uint32_t t_uint32;
-        int64_t t_int64;
-        uint64_t t_uint64;
-#endif
-    } conv_arg;              // Used to temporarily hold a single type-converted
-                             // option-argument.
-#if OPTPARSE_LIST_SUPPORT
-    void *list_array = NULL; // Used to temporarily or permanently store a
-                             // type-converted list.
-    size_t list_size = 0;    // The converted list's size.
-    char *oarg = arg;        // Optionally used to back up the original
-                             // option-argument.
-#endif
-
-    // Set option's flag.
-    if (opt->flag != NULL) {
-        switch (opt->flag_type) {
-            case FLAG_TYPE_SET_TRUE:
-                *(int *) opt->flag = 1;
-                break;
-            case FLAG_TYPE_SET_FALSE:
-                *(int *) opt->flag = 0;
-                break;
-            case FLAG_TYPE_INCREMENT:
-                *(int *) opt->flag += 1;
-                break;
-            case FLAG_TYPE_DECREMENT:
-                *(int *) opt->flag -= 1;
-                break;
+    const unsigned char *digits = p;
+    unsigned long long value = 0;
+    unsigned digit;
+    if (base == 10) {
+        while ((digit = *p - '0') < 10) {
+            value = value * 10 + digit;
+            p++;
+        }
+    } else {
+        while ((digit = digit_value(*p)) < base) {
+            value = value * base + digit;
+            p++;
         }
     }
+    if (p == digits || *p != '\0') {
+        return 1;
+    }
 
-    // Type-convert the option-argument.
-    if (arg) {
-#if OPTPARSE_LIST_SUPPORT
-        if (opt->arg_delim) { // Option-argument is a list.
-            // Back up the original option-argument, if necessary.
-            if (opt->function && opt->function_type == FUNCTION_TYPE_OARG) {
-                oarg = malloc(strlen(arg) + 1);
-                if (oarg == NULL) {
-                    optparse_error("Out of memory.\n");
-                }
-                strcpy(oarg, arg);
+    // Up to 19 decimal, 16 hexadecimal or 21 octal digits can't wrap around,
+    // longer numbers are checked digit by digit.
+    if (p - digits > (base == 10 ? 19 : base == 16 ? 16 : 21)) {
+        unsigned long long cutoff = limit / base;
+        unsigned cutlim = limit % base;
+        value = 0;
+        for (p = digits; *p != '\0'; p++) {
+            digit = digit_value(*p);
+            if (value > cutoff || (value == cutoff && digit > cutlim)) {
+                return -1;
             }
+            value = value * base + digit;
+        }
+    } else if (value > limit) {
+        return -1;
+    }
 
-            list_size = strtoarr(arg, &list_array, opt->arg_delim,
-                opt->arg_data_type);
+    if (min == 0) {
+        if (negative) {
+            value = (0 - value) & limit;
+            negative = false;
+        }
+        if (value > max) {
+            return -1;
+        }
+    }
+    store_int(x, data_type, value, negative);
+
+    return 0;
+}
+
+#if USE_FAST_FLOATS
+// Converts a number of len characters to float or double, like strtox(), but
+// faster. Only plain decimal notation is handled: an optional sign, digits with
+// an optional decimal point, and an optional exponent. The conversion is done
+// with a single, exactly rounded multiplication or division (Clinger's fast
+// path), which is only possible if the digits fit into a double's mantissa and
+// the power of ten is exact as a double. Such results are identical to those
+// of strtod().
+// Return value: 0 on success, 2 if the number must be converted by strtox()
+static int strtofp_fast(const char *str, size_t len, void *x,
+    enum optparse_data_type data_type)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+        1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const unsigned long long max_mantissa = 1ULL << 53;
+    const char *p = str, *end = str + len;
+
+    _Bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    unsigned long long mantissa = 0;
+    int n_digits = 0;
+    int n_significant = 0; // Digits since the first non-zero one
+    int exponent = 0;
+    for (; p < end && (unsigned) (*p - '0') < 10; p++, n_digits++) {
+        mantissa = mantissa * 10 + (*p - '0');
+        n_significant += n_significant || *p != '0';
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && (unsigned) (*p - '0') < 10; p++, n_digits++) {
+            mantissa = mantissa * 10 + (*p - '0');
+            n_significant += n_significant || *p != '0';
+            exponent--;
+        }
+    }
+    if (n_digits == 0 || n_significant > 19) {
+        return 2;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        _Bool negative_exponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative_exponent = *p == '-';
+            p++;
+        }
+        const char *exponent_digits = p;
+        int e = 0;
+        for (; p < end && (unsigned) (*p - '0') < 10; p++) {
+            if (e < 1000) {
+                e = e * 10 + (*p - '0');
+            }
+        }
+        if (p == exponent_digits) {
+            return 2;
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+    if (p != end || mantissa > max_mantissa) {
+        return 2;
+    }
+
+    double value;
+    if (exponent < 0) {
+        if (exponent < -22) {
+            return 2;
+        }
+        value = (double) mantissa / powers[-exponent];
+    } else {
+        // Powers of ten beyond 1e22 aren't exact, but some of them can be moved
+        // into the mantissa, as in "12e25" = 12000 * 1e22.
+        for (; exponent > 22; exponent--) {
+            mantissa *= 10;
+            if (mantissa > max_mantissa) {
+                return 2;
+            }
+        }
+        value = (double) mantissa * powers[exponent];
+    }
+
+    if (negative) {
+        value = -value;
+    }
+    if (data_type == DATA_TYPE_FLT) {
+        *(float *) x = (float) value;
+    } else {
+        *(double *) x = value;
+    }
+
+    return 0;
+}
+#endif
+
+// Converts an ASCII letter to lowercase, regardless of the locale.
+static int ascii_tolower(int c)
+{
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+// Compares a string of len characters to a keyword, ignoring the case of ASCII
+// letters.
+// Return value: 1 if they are equal, otherwise 0
+static int keyword_equals(const char *str, size_t len, const char *keyword)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (keyword[i] == '\0'
+                || ascii_tolower(str[i]) != ascii_tolower(keyword[i])) {
+            return 0;
+        }
+    }
+    return keyword[len] == '\0';
+}
+
+// Converts a keyword like "yes" or "Off" of len characters to a boolean.
+// Return value: 0 on success, 1 if the string is not a keyword
+static int match_bool(const char *str, size_t len, _Bool *x)
+{
+    static const struct {
+        const char *keyword;
+        _Bool value;
+    } user_keywords[] = { { NULL, false }, OPTPARSE_BOOL_KEYWORDS };
+
+    // Built-in keywords differ in length or, if not, in their first letter.
+    const char *keyword = NULL;
+    _Bool value = true;
+    switch (len) {
+        case 2:
+            keyword = (str[0] | 0x20) == 'o' ? "on" : "no";
+            value = keyword[0] == 'o';
+            break;
+        case 3:
+            keyword = (str[0] | 0x20) == 'y' ? "yes" : "off";
+            value = keyword[0] == 'y';
+            break;
+        case 4:
+            keyword = "true";
+            break;
+        case 5:
+            keyword = "false";
+            value = false;
+            break;
+        case 7:
+            keyword = "enabled";
+            break;
+        case 8:
+            keyword = "disabled";
+            value = false;
+            break;
+    }
+    if (keyword != NULL && keyword_equals(str, len, keyword)) {
+        *x = value;
+        return 0;
+    }
+
+    for (size_t i = 1; i < sizeof user_keywords / sizeof *user_keywords; i++) {
+        if (keyword_equals(str, len, user_keywords[i].keyword)) {
+            *x = user_keywords[i].value;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Calls a function as specified by FUNCTION_TYPE_TARG.
+// value: points to the type-converted option-argument
+static void call_targ(void (*function)(void), enum optparse_data_type data_type,
+    void *value)
+{
+    switch (data_type) {
+        case DATA_TYPE_STR:
+            ((void (*)(char *)) function)(*(char **) value);
+            break;
+        case DATA_TYPE_CHAR:
+            ((void (*)(char)) function)(*(char *) value);
+            break;
+        case DATA_TYPE_SCHAR:
+            ((void (*)(signed char)) function)(*(signed char *) value);
+            break;
+        case DATA_TYPE_UCHAR:
+            ((void (*)(unsigned char)) function)(*(unsigned char *) value);
+            break;
+        case DATA_TYPE_SHRT:
+            ((void (*)(short)) function)(*(short *) value);
+            break;
+        case DATA_TYPE_USHRT:
+            ((void (*)(unsigned short)) function)(*(unsigned short *) value);
+            break;
+        case DATA_TYPE_INT:
+            ((void (*)(int)) function)(*(int *) value);
+            break;
+        case DATA_TYPE_UINT:
+            ((void (*)(unsigned int)) function)(*(unsigned int *) value);
+            break;
+        case DATA_TYPE_LONG:
+            ((void (*)(long)) function)(*(long *) value);
+            break;
+        case DATA_TYPE_ULONG:
+            ((void (*)(unsigned long)) function)(*(unsigned long *) value);
+            break;
+        case DATA_TYPE_LLONG:
+            ((void (*)(long long)) function)(*(long long *) value);
+            break;
+        case DATA_TYPE_ULLONG:
+            ((void (*)(unsigned long long)) function)(
+                *(unsigned long long *) value);
+            break;
+#if OPTPARSE_FLOATING_POINT_SUPPORT
+        case DATA_TYPE_FLT:
+            ((void (*)(float)) function)(*(float *) value);
+            break;
+        case DATA_TYPE_DBL:
+            ((void (*)(double)) function)(*(double *) value);
+            break;
+        case DATA_TYPE_LDBL:
+            ((void (*)(long double)) function)(*(long double *) value);
+            break;
+#endif
+        case DATA_TYPE_BOOL:
+            ((void (*)(_Bool)) function)(*(_Bool *) value);
+            break;
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+        case DATA_TYPE_INT8:
+            ((void (*)(int8_t)) function)(*(int8_t *) value);
+            break;
+        case DATA_TYPE_UINT8:
+            ((void (*)(uint8_t)) function)(*(uint8_t *) value);
+            break;
+        case DATA_TYPE_INT16:
+            ((void (*)(int16_t)) function)(*(int16_t *) value);
+            break;
+        case DATA_TYPE_UINT16:
+            ((void (*)(uint16_t)) function)(*(uint16_t *) value);
+            break;
+        case DATA_TYPE_INT32:
+            ((void (*)(int32_t)) function)(*(int32_t *) value);
+            break;
+        case DATA_TYPE_UINT32:
+            ((void (*)(uint32_t)) function)(*(uint32_t *) value);
+            break;
+        case DATA_TYPE_INT64:
+            ((void (*)(int64_t)) function)(*(int64_t *) value);
+            break;
+        case DATA_TYPE_UINT64:
+            ((void (*)(uint64_t)) function)(*(uint64_t *) value);
+            break;
+#endif
+    }
+}
+
+#if OPTPARSE_LIST_SUPPORT
+// Calls a function as specified by FUNCTION_TYPE_TARG_ARRAY.
+static void call_targ_array(void (*function)(void),
+    enum optparse_data_type data_type, size_t size, void *array)
+{
+    switch (data_type) {
+        case DATA_TYPE_STR:
+            ((void (*)(size_t, char **)) function)(size, array);
+            break;
+        case DATA_TYPE_CHAR:
+            ((void (*)(size_t, char *)) function)(size, array);
+            break;
+        case DATA_TYPE_SCHAR:
+            ((void (*)(size_t, signed char *)) function)(size, array);
+            break;
+        case DATA_TYPE_UCHAR:
+            ((void (*)(size_t, unsigned char *)) function)(size, array);
+            break;
+        case DATA_TYPE_SHRT:
+            ((void (*)(size_t, short *)) function)(size, array);
+            break;
+        case DATA_TYPE_USHRT:
+            ((void (*)(size_t, unsigned short *)) function)(size, array);
+            break;
+        case DATA_TYPE_INT:
+            ((void (*)(size_t, int *)) function)(size, array);
+            break;
+        case DATA_TYPE_UINT:
+            ((void (*)(size_t, unsigned int *)) function)(size, array);
+            break;
+        case DATA_TYPE_LONG:
+            ((void (*)(size_t, long *)) function)(size, array);
+            break;
+        case DATA_TYPE_ULONG:
+            ((void (*)(size_t, unsigned long *)) function)(size, array);
+            break;
+        case DATA_TYPE_LLONG:
+            ((void (*)(size_t, long long *)) function)(size, array);
+            break;
+        case DATA_TYPE_ULLONG:
+            ((void (*)(size_t, unsigned long long *)) function)(size, array);
+            break;
+#if OPTPARSE_FLOATING_POINT_SUPPORT
+        case DATA_TYPE_FLT:
+            ((void (*)(size_t, float *)) function)(size, array);
+            break;
+        case DATA_TYPE_DBL:
+            ((void (*)(size_t, double *)) function)(size, array);
+            break;
+        case DATA_TYPE_LDBL:
+            ((void (*)(size_t, long double *)) function)(size, array);
+            break;
+#endif
+        case DATA_TYPE_BOOL:
+            ((void (*)(size_t, _Bool *)) function)(size, array);
+            break;
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+        case DATA_TYPE_INT8:
+            ((void (*)(size_t, int8_t *)) function)(size, array);
+            break;
+        case DATA_TYPE_UINT8:
+            ((void (*)(size_t, uint8_t *)) function)(size, array);
+            break;
+        case DATA_TYPE_INT16:
+            ((void (*)(size_t, int16_t *)) function)(size, array);
+            break;
+        case DATA_TYPE_UINT16:
+            ((void (*)(size_t, uint16_t *)) function)(size, array);
+            break;
+        case DATA_TYPE_INT32:
+            ((void (*)(size_t, int32_t *)) function)(size, array);
+            break;
+        case DATA_TYPE_UINT32:
+            ((void (*)(size_t, uint32_t *)) function)(size, array);
+            break;
+        case DATA_TYPE_INT64:
+            ((void (*)(size_t, int64_t *)) function)(size, array);
+            break;
+        case DATA_TYPE_UINT64:
+            ((void (*)(size_t, uint64_t *)) function)(size, array);
+            break;
+#endif
+    }
+}
+#endif
+
+#if OPTPARSE_LIST_SUPPORT
+// The maximum number of distinct delimiters that are searched for with vector
+// instructions; sets with more delimiters are searched one byte at a time.
+#define DELIM_VECTOR_MAX 4
+
+// A set of list delimiters.
+struct delim_set {
+    unsigned char bits[(UCHAR_MAX + 1) / CHAR_BIT];
+                            // Bit set, indexed by (unsigned char) delimiter.
+    int n_chars;            // The number of distinct delimiters.
+    unsigned char chars[DELIM_VECTOR_MAX];
+                            // The delimiters, if there are not too many.
+};
+
+// Returns whether a character is a delimiter.
+static int is_delim(const struct delim_set *set, unsigned char c)
+{
+    return set->bits[c / CHAR_BIT] & (1 << (c % CHAR_BIT));
+}
+
+// Builds a delimiter set from a string containing the delimiters.
+static void build_delim_set(struct delim_set *set, const char *delim)
+{
+    memset(set, 0, sizeof (*set));
+    for (; *delim != '\0'; delim++) {
+        unsigned char c = *delim;
+        if (is_delim(set, c)) {
+            continue;
+        }
+        set->bits[c / CHAR_BIT] |= 1 << (c % CHAR_BIT);
+        if (set->n_chars < DELIM_VECTOR_MAX) {
+            set->chars[set->n_chars] = c;
+        }
+        set->n_chars++;
+    }
+
+    // Fill unused slots, so vector comparisons need not check how many there
+    // are.
+    for (int i = set->n_chars; i > 0 && i < DELIM_VECTOR_MAX; i++) {
+        set->chars[i] = set->chars[0];
+    }
+}
+
+// Returns a pointer to the first delimiter in the range [p, end), or end if
+// there is none.
+static char *find_delim(char *p, char *end, const struct delim_set *set)
+{
+    if (set->n_chars > 0 && set->n_chars <= DELIM_VECTOR_MAX) {
+#if defined __GNUC__ && defined __AVX2__
+        __m256i d0 = _mm256_set1_epi8((char) set->chars[0]);
+        __m256i d1 = _mm256_set1_epi8((char) set->chars[1]);
+        __m256i d2 = _mm256_set1_epi8((char) set->chars[2]);
+        __m256i d3 = _mm256_set1_epi8((char) set->chars[3]);
+        while (end - p >= 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *) p);
+            __m256i m = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, d0),
+                    _mm256_cmpeq_epi8(v, d1)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, d2),
+                    _mm256_cmpeq_epi8(v, d3)));
+            unsigned int mask = (unsigned int) _mm256_movemask_epi8(m);
+            if (mask) {
+                return p + __builtin_ctz(mask);
+            }
+            p += 32;
+        }
+#elif defined __GNUC__ && defined __SSE2__
+        __m128i d0 = _mm_set1_epi8((char) set->chars[0]);
+        __m128i d1 = _mm_set1_epi8((char) set->chars[1]);
+        __m128i d2 = _mm_set1_epi8((char) set->chars[2]);
+        __m128i d3 = _mm_set1_epi8((char) set->chars[3]);
+        while (end - p >= 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) p);
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, d0), _mm_cmpeq_epi8(v, d1)),
+                _mm_or_si128(_mm_cmpeq_epi8(v, d2), _mm_cmpeq_epi8(v, d3)));
+            unsigned int mask = (unsigned int) _mm_movemask_epi8(m);
+            if (mask) {
+                return p + __builtin_ctz(mask);
+            }
+            p += 16;
+        }
+#endif
+
+        // SWAR: test 8 bytes at a time for a byte that equals a delimiter,
+        // using the "has zero byte" bit trick.
+        const unsigned long long ones = 0x0101010101010101ULL;
+        const unsigned long long highs = 0x8080808080808080ULL;
+        unsigned long long d[DELIM_VECTOR_MAX];
+        for (int i = 0; i < DELIM_VECTOR_MAX; i++) {
+            d[i] = set->chars[i] * ones;
+        }
+        while (end - p >= 8) {
+            unsigned long long v;
+            memcpy(&v, p, 8);
+            unsigned long long found = 0;
+            for (int i = 0; i < DELIM_VECTOR_MAX; i++) {
+                unsigned long long x = v ^ d[i];
+                found |= (x - ones) & ~x & highs;
+            }
+            if (found) {
+                break; // The scalar loop finds the exact position.
+            }
+            p += 8;
+        }
+    }
+
+    while (p < end && !is_delim(set, *p)) {
+        p++;
+    }
+    return p;
+}
+
+// Converts up to 8 decimal digits to a number.
+// Return value: 0 on success, 1 if a character is not a digit
+static int parse_8_digits(const char *str, size_t n, unsigned long long *value)
+{
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // SWAR: check and convert all 8 digits at once, left-padded with '0'.
+    char buffer[8];
+    memset(buffer, '0', 8);
+    memcpy(buffer + 8 - n, str, n);
+    unsigned long long v;
+    memcpy(&v, buffer, 8);
+
+    if ((v & 0xF0F0F0F0F0F0F0F0ULL) != 0x3030303030303030ULL
+            || ((v + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL)
+            != 0x3030303030303030ULL) {
+        return 1;
+    }
+
+    v -= 0x3030303030303030ULL;
+    v = v * 10 + (v >> 8); // Pairs of digits
+    v = ((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))
+        + ((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+    *value = v;
+#else
+    unsigned long long v = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (str[i] < '0' || str[i] > '9') {
+            return 1;
+        }
+        v = v * 10 + (str[i] - '0');
+    }
+    *value = v;
+#endif
+
+    return 0;
+}
+
+// Converts a list item of len characters to an integer of the specified data
+// type, like strtox(), but faster. Only common notations are handled: an
+// optional "-" (for signed types), followed by up to 16 decimal digits (without
+// leading zeros) or by "0x" and up to 15 hexadecimal digits.
+// min, max: the data type's range (see get_int_range())
+// Return value: same as strtox(); 2 if the item must be converted by strtox()
+static int strtoint_fast(const char *item, size_t len, void *x,
+    enum optparse_data_type data_type, long long min, unsigned long long max)
+{
+    _Bool negative = false;
+    if (item[0] == '-') {
+        if (min == 0) {
+            return 2; // strtoul() would negate the value.
+        }
+        negative = true;
+        item++;
+        len--;
+    }
+
+    unsigned long long value = 0;
+    if (len > 2 && item[0] == '0' && (item[1] == 'x' || item[1] == 'X')) {
+        if (len > 2 + 15) {
+            return 2;
+        }
+        for (size_t i = 2; i < len; i++) {
+            int digit;
+            if (item[i] >= '0' && item[i] <= '9') {
+                digit = item[i] - '0';
+            } else if (item[i] >= 'a' && item[i] <= 'f') {
+                digit = item[i] - 'a' + 10;
+            } else if (item[i] >= 'A' && item[i] <= 'F') {
+                digit = item[i] - 'A' + 10;
+            } else {
+                return 2;
+            }
+            value = value * 16 + digit;
+        }
+    } else {
+        if (len == 0 || len > 16 || (item[0] == '0' && len > 1)) {
+            return 2;
+        }
+        if (len > 8) {
+            unsigned long long high;
+            if (parse_8_digits(item, len - 8, &high)
+                    || parse_8_digits(item + len - 8, 8, &value)) {
+                return 2;
+            }
+            value += high * 100000000;
+        } else if (parse_8_digits(item, len, &value)) {
+            return 2;
+        }
+    }
+
+    // Check the range and store the value.
+    if (negative ? value > (unsigned long long) -(min + 1) + 1 : value > max) {
+        return -1;
+    }
+    return store_int(x, data_type, value, negative) ? 2 : 0;
+}
+
+// Passes converted list items to an option's function, as specified by
+// FUNCTION_TYPE_TARG_EACH or FUNCTION_TYPE_TARG_CHUNK.
+static void pass_list_items(struct optparse_opt *opt,
+    enum optparse_data_type data_type, size_t n, void *items)
+{
+    if (opt->function_type == FUNCTION_TYPE_TARG_EACH) {
+        int data_type_size = get_data_type_size(data_type);
+        for (size_t i = 0; i < n; i++) {
+            call_targ(opt->function, data_type,
+                (char *) items + i * data_type_size);
+        }
+    } else {
+        call_targ_array(opt->function, data_type, n, items);
+    }
+}
+
+// The state of a list's conversion. A list that is read from a file may be
+// converted in several parts.
+struct list_conv {
+    struct optparse_ctx *ctx;
+    struct optparse_opt *opt;       // The option the list belongs to.
+    enum optparse_data_type data_type;
+    int data_type_size;
+    struct delim_set set;
+    long long min;                  // The data type's range, if it is an
+    unsigned long long max;         // integer type (see get_int_range()).
+    int is_int;
+    void *array;                    // The converted items, or a chunk buffer.
+    size_t capacity;                // The number of items .array can hold.
+    _Bool fixed;                    // Whether .array is the caller's, and
+                                    // must not grow.
+    size_t size;                    // The number of items in .array.
+    size_t chunk_size;              // See strtoarr().
+    size_t n_passed;                // The number of items passed in previous
+                                    // chunks.
+    int n_errors;
+};
+
+// Passes the items of a full or final chunk to the option's function and
+// empties the chunk buffer. After an invalid item, no more items are passed.
+static void flush_list_chunk(struct list_conv *conv)
+{
+    if (conv->size && conv->n_errors == 0) {
+        pass_list_items(conv->opt, conv->data_type, conv->size, conv->array);
+    }
+    conv->n_passed += conv->size;
+    conv->size = 0;
+}
+
+// Reports a list item that does not fit into a fixed array.
+// in_place: see convert_list_items()
+// Return value: -1
+static int report_too_many_items(struct list_conv *conv, char *list_item,
+    size_t len, _Bool in_place)
+{
+    char *item = list_item;
+    if (in_place) {
+        item[len] = '\0';
+    } else {
+        item = ctx_malloc(conv->ctx, len + 1);
+        if (item == NULL) {
+            report_error(conv->ctx, (struct optparse_error) {
+                .type = ERROR_TYPE_OUT_OF_MEMORY, .opt = conv->opt });
+            return -1;
+        }
+        memcpy(item, list_item, len);
+        item[len] = '\0';
+    }
+    report_error(conv->ctx, (struct optparse_error) {
+        .type = ERROR_TYPE_TOO_MANY_ITEMS,
+        .token = item,
+        .opt = conv->opt,
+        .list_index = conv->n_passed + conv->size,
+    });
+    return -1;
+}
+
+// Converts the list items found between string and end, which must not be in
+// the middle of a list item.
+// in_place: if true, list items are terminated in place, altering the string;
+//           otherwise, the string's memory is treated as read-only and
+//           temporary: it is never written to, and invalid items are reported
+//           with dynamically allocated copies.
+// Return value: 0 on success; -1 if memory could not be allocated or the list
+// does not fit into a fixed array (which has been reported)
+static int convert_list_items(struct list_conv *conv, char *string, char *end,
+    _Bool in_place)
+{
+    // String items point into the list and thus can't be temporary.
+    assert(in_place || conv->data_type != DATA_TYPE_STR);
+
+    char *list_item = string;
+    while (list_item < end) {
+        char *item_end = find_delim(list_item, end, &conv->set);
+        if (item_end == list_item) { // Empty list item
+            list_item++;
+            continue;
+        }
+        size_t len = item_end - list_item;
+
+        if (conv->size == conv->capacity && conv->fixed) {
+            return report_too_many_items(conv, list_item, len, in_place);
+        }
+        if (conv->size == conv->capacity) {
+            size_t capacity = conv->capacity ? conv->capacity * 2 : 16;
+            void *ret = ctx_realloc(conv->ctx, conv->array,
+                capacity * conv->data_type_size);
+            if (ret == NULL) {
+                goto out_of_memory;
+            }
+            conv->array = ret;
+            conv->capacity = capacity;
+        }
+
+        void *x = ((char *) conv->array) + conv->size * conv->data_type_size;
+        int ret = 2;
+        if (conv->is_int) {
+            ret = strtoint_fast(list_item, len, x, conv->data_type, conv->min,
+                conv->max);
+        } else if (conv->data_type == DATA_TYPE_BOOL) {
+            ret = match_bool(list_item, len, x) ? 2 : 0;
+#if USE_FAST_FLOATS
+        } else if (conv->data_type == DATA_TYPE_FLT
+                || conv->data_type == DATA_TYPE_DBL) {
+            ret = strtofp_fast(list_item, len, x, conv->data_type);
+#endif
+        }
+
+        // Both strtox() and error reports require a terminated list item.
+        char buffer[64];
+        char *item = list_item;
+        if (in_place) {
+            *item_end = '\0';
+        } else if (ret) {
+            item = len < sizeof buffer ? buffer
+                : ctx_malloc(conv->ctx, len + 1);
+            if (item == NULL) {
+                goto out_of_memory;
+            }
+            memcpy(item, list_item, len);
+            item[len] = '\0';
+        }
+
+        if (ret == 2) {
+            ret = strtox(item, x, conv->data_type);
+        }
+        if (ret) {
+            if (item == buffer) { // The token must outlive this function.
+                item = ctx_malloc(conv->ctx, len + 1);
+                if (item == NULL) {
+                    goto out_of_memory;
+                }
+                memcpy(item, buffer, len + 1);
+            }
+            report_error(conv->ctx, (struct optparse_error) {
+                .type = ret == 1 ? ERROR_TYPE_INVALID_ARGUMENT
+                    : ERROR_TYPE_OUT_OF_RANGE,
+                .token = item,
+                .opt = conv->opt,
+                .list_index = conv->n_passed + conv->size,
+            });
+            conv->n_errors++;
+        } else if (item != list_item && item != buffer) {
+            ctx_free(conv->ctx, item);
+        }
+
+        conv->size++;
+        if (conv->size == conv->chunk_size) {
+            flush_list_chunk(conv);
+        }
+        list_item = item_end + 1;
+    }
+
+    return 0;
+
+    out_of_memory:
+    report_error(conv->ctx, (struct optparse_error) {
+        .type = ERROR_TYPE_OUT_OF_MEMORY, .opt = conv->opt });
+    return -1;
+}
+
+#if OPTPARSE_LIST_FILES
+#define LIST_READ_SIZE 65536 // The size of the chunks streams are read in.
+
+// Reports a list file that could not be read.
+// Return value: -1
+static int report_file_error(struct list_conv *conv, char *arg)
+{
+    report_error(conv->ctx, (struct optparse_error) {
+        .type = ERROR_TYPE_FILE_ERROR,
+        .token = arg[0] == '@' ? arg + 1 : arg,
+        .opt = conv->opt,
+    });
+    return -1;
+}
+
+// Reads a list from a stream and converts its items. Unless the items are
+// strings, which point into the list, the stream is read in fixed-size chunks
+// and never held in memory as a whole.
+// arg: the option-argument the stream was opened for
+// Return value: 0 on success; -1 on error (which has been reported)
+static int read_list_stream(struct list_conv *conv, FILE *stream, char *arg)
+{
+    _Bool keep = conv->data_type == DATA_TYPE_STR;
+    size_t capacity = LIST_READ_SIZE;
+    char *buffer = ctx_malloc(conv->ctx, capacity + 1);
+    if (buffer == NULL) {
+        goto out_of_memory;
+    }
+
+    size_t len = 0;
+    _Bool eof = false;
+    while (!eof) {
+        if (len == capacity) { // The buffer is full of one list item.
+            char *ret = ctx_realloc(conv->ctx, buffer, capacity * 2 + 1);
+            if (ret == NULL) {
+                ctx_free(conv->ctx, buffer);
+                goto out_of_memory;
+            }
+            buffer = ret;
+            capacity *= 2;
+        }
+
+        size_t n = fread(buffer + len, 1, capacity - len, stream);
+        eof = n < capacity - len;
+        len += n;
+        if (ferror(stream)) {
+            ctx_free(conv->ctx, buffer);
+            return report_file_error(conv, arg);
+        }
+        if (keep) {
+            continue;
+        }
+
+        // Convert all complete items and move the rest to the buffer's start.
+        char *end = buffer + len;
+        if (!eof) {
+            while (end > buffer && !is_delim(&conv->set, end[-1])) {
+                end--;
+            }
+        }
+        if (convert_list_items(conv, buffer, end, false)) {
+            ctx_free(conv->ctx, buffer);
+            return -1;
+        }
+        len -= end - buffer;
+        memmove(buffer, end, len);
+    }
+
+    if (keep) {
+        buffer[len] = '\0';
+        if (convert_list_items(conv, buffer, buffer + len, true)) {
+            ctx_free(conv->ctx, buffer);
+            return -1;
+        }
+
+        // Streamed items only need to exist while they are being passed.
+        if (conv->chunk_size || conv->size == 0) {
+            flush_list_chunk(conv);
+            ctx_free(conv->ctx, buffer);
+        }
+    } else {
+        ctx_free(conv->ctx, buffer);
+    }
+    return 0;
+
+    out_of_memory:
+    report_error(conv->ctx, (struct optparse_error) {
+        .type = ERROR_TYPE_OUT_OF_MEMORY, .opt = conv->opt });
+    return -1;
+}
+
+#if USE_MMAP
+// Maps a regular file into memory and converts its list items without copying
+// them.
+// Return value: 0 on success; -1 on error (which has been reported); 1 if the
+// file is not a regular file
+static int map_list_file(struct list_conv *conv, char *arg)
+{
+    int fd = open(arg + 1, O_RDONLY);
+    if (fd == -1) {
+        return report_file_error(conv, arg);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return report_file_error(conv, arg);
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        return 1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    size_t size = st.st_size;
+    char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return report_file_error(conv, arg);
+    }
+
+    int ret = convert_list_items(conv, map, map + size, false);
+    munmap(map, size);
+    return ret;
+}
+#endif
+
+// Reads a list from the file specified by an option-argument of the form
+// "@FILE", or from standard input if the option-argument is "-", and converts
+// its items.
+// Return value: 0 on success; -1 on error (which has been reported)
+static int read_list_file(struct list_conv *conv, char *arg)
+{
+    if (arg[0] == '-') {
+        return read_list_stream(conv, stdin, arg);
+    }
+
+#if USE_MMAP
+    if (conv->data_type != DATA_TYPE_STR) {
+        int ret = map_list_file(conv, arg);
+        if (ret != 1) {
+            return ret;
+        }
+    }
+#endif
+
+    FILE *file = fopen(arg + 1, "rb");
+    if (file == NULL) {
+        return report_file_error(conv, arg);
+    }
+    int ret = read_list_stream(conv, file, arg);
+    fclose(file);
+    return ret;
+}
+#endif
+
+// Converts a non-literal string that has the form of a list into an array of
+// specified data type. The string will be altered and cannot be used anymore in
+// its original form. The array's data type must match the specified data type.
+// If the list contains items, the array's memory will be allocated with the
+// context's allocator, which should free it if it is no longer needed.
+// To avoid compiler warnings, the array pointer can be explicitly cast to
+// void *: "strtoarr(..., (void *) &array, ...);".
+// Like with strtok(), empty list items are skipped.
+// The number of list items stored in the array is written to *array_size.
+// If the option has .arg_from_file set, "@FILE" and "-" make the list be read
+// from FILE or standard input, respectively.
+// opt: the option the list belongs to (used for error reporting)
+// chunk_size: if not 0, the items are not stored in an array, but passed to
+//             the option's function while converting, in chunks of up to
+//             chunk_size items (at most OPTPARSE_LIST_CHUNK_SIZE); after an
+//             invalid item, no more items are passed
+// capacity: if not 0, *array is a caller-owned array of capacity items, which
+//           the items are stored in instead; it is left unchanged
+// Return value: 0 on success; otherwise, all errors have been reported and
+// *array is NULL, unless it is caller-owned.
+static int strtoarr(struct optparse_ctx *ctx, struct optparse_opt *opt,
+    char *string, void **array, size_t *array_size, char *delim,
+    enum optparse_data_type data_type, size_t chunk_size, size_t capacity)
+{
+    void *fixed_array = capacity ? *array : NULL;
+    *array = fixed_array;
+    *array_size = 0;
+    if (string == NULL || delim == NULL) {
+        return 0;
+    }
+
+    // Convert list items to specified data type and store them in an array,
+    // which grows as needed, or in a fixed-size chunk buffer.
+    union optparse_data chunk[OPTPARSE_LIST_CHUNK_SIZE];
+    struct list_conv conv = {
+        .ctx = ctx,
+        .opt = opt,
+        .data_type = data_type,
+        .data_type_size = get_data_type_size(data_type),
+        .chunk_size = chunk_size,
+    };
+    build_delim_set(&conv.set, delim);
+    conv.is_int = get_int_range(data_type, &conv.min, &conv.max);
+    if (chunk_size) {
+        conv.array = chunk;
+        conv.capacity = chunk_size;
+    } else if (capacity) {
+        conv.array = fixed_array;
+        conv.capacity = capacity;
+        conv.fixed = true;
+    }
+
+    int ret;
+#if OPTPARSE_LIST_FILES
+    if (opt->arg_from_file && (string[0] == '@' || strcmp(string, "-") == 0)) {
+        ret = read_list_file(&conv, string);
+    } else
+#endif
+    ret = convert_list_items(&conv, string, string + strlen(string), true);
+
+    if (chunk_size) {
+        flush_list_chunk(&conv);
+        *array_size = conv.n_passed;
+        return ret ? 1 : conv.n_errors;
+    }
+
+    if (ret || conv.n_errors) {
+        if (!conv.fixed) {
+            ctx_free(ctx, conv.array);
+        }
+        return ret ? 1 : conv.n_errors;
+    }
+
+    *array = conv.array;
+    *array_size = conv.size;
+    return 0;
+}
+#endif
+
+// Modifies an option's flag as specified by the option's .flag_type.
+static void set_flag(int *flag, enum optparse_flag_type flag_type)
+{
+    switch (flag_type) {
+        case FLAG_TYPE_SET_TRUE:
+            *flag = 1;
+            break;
+        case FLAG_TYPE_SET_FALSE:
+            *flag = 0;
+            break;
+        case FLAG_TYPE_INCREMENT:
+            *flag += 1;
+            break;
+        case FLAG_TYPE_DECREMENT:
+            *flag -= 1;
+            break;
+    }
+}
+
+// Stores an option's results in the context's value slots (batch mode).
+static void store_value(struct optparse_ctx *ctx, struct optparse_opt *opt,
+    char *arg, union optparse_data *conv_arg, void *list_array,
+    size_t list_size)
+{
+    struct optparse_value *value = ctx->values
+        + get_option_id(ctx->active_cmd, opt);
+
+    value->count++;
+    if (opt->flag != NULL) {
+        set_flag(&value->flag, opt->flag_type);
+    }
+
+    if (arg) {
+#if OPTPARSE_LIST_SUPPORT
+        if (opt->arg_delim) {
+            ctx_free(ctx, value->data.t_array);
+            value->data.t_array = list_array;
+            value->list_size = list_size;
         } else
+#else
+        (void) list_array;
+        (void) list_size;
+#endif
+        if (opt->arg_data_type == DATA_TYPE_STR) {
+            value->data.t_str = arg;
+        } else {
+            value->data = *conv_arg;
+        }
+    }
+}
+
+// Executes an option structure's tasks.
+// arg: the option's option-argument; NULL if none provided by the user.
+static void execute_option(struct optparse_ctx *ctx, struct optparse_opt *opt,
+    char *arg)
+{
+    union optparse_data conv_arg;
+                             // Used to temporarily hold a single type-converted
+                             // option-argument.
+#if OPTPARSE_LIST_SUPPORT
+    void *list_array = NULL; // Used to temporarily or permanently store a
+                             // type-converted list.
+    size_t list_size = 0;    // The converted list's size.
+    char *oarg = arg;        // Optionally used to back up the original
+                             // option-argument.
+#endif
+
+#if OPTPARSE_ENV_VARIABLES
+    if (ctx->env_seen) {
+        ctx->env_seen[opt - ctx->active_cmd->options] = true;
+    }
+#endif
+
+#if OPTPARSE_GENERATED_PARSER
+    // Outside of batch mode, the generated code converts, stores and calls
+    // directly. It hands options with lists back.
+    if (ctx->values == NULL && ctx->active_cmd->_index) {
+        int ret = ctx->active_cmd->_index->generated->execute(opt,
+            (int) (opt - ctx->active_cmd->options), arg);
+        if (ret != 2) {
+            if (ret) {
+                report_error(ctx, (struct optparse_error) {
+                    .type = ret == 1 ? ERROR_TYPE_INVALID_ARGUMENT
+                        : ERROR_TYPE_OUT_OF_RANGE,
+                    .token = arg,
+                    .opt = opt,
+                });
+            }
+            return;
+        }
+    }
+#endif
+
+    // Type-convert the option-argument. On error, the option is skipped.
+    if (arg) {
+#if OPTPARSE_LIST_SUPPORT
+        if (opt->arg_delim) { // Option-argument is a list.
+            // Back up the original option-argument, if necessary.
+            if (opt->function && opt->function_type == FUNCTION_TYPE_OARG
+                    && ctx->values == NULL) {
+                oarg = ctx_malloc(ctx, strlen(arg) + 1);
+                if (oarg == NULL) {
+                    report_error(ctx, (struct optparse_error) {
+                        .type = ERROR_TYPE_OUT_OF_MEMORY, .opt = opt });
+                    return;
+                }
+                strcpy(oarg, arg);
+            }
+
+            // Stream the items to the option's function, if requested, or
+            // convert them into the caller's array.
+            size_t chunk_size = 0;
+            size_t capacity = 0;
+            if (opt->function && ctx->values == NULL) {
+                if (opt->function_type == FUNCTION_TYPE_TARG_EACH) {
+                    chunk_size = 1;
+                } else if (opt->function_type == FUNCTION_TYPE_TARG_CHUNK) {
+                    chunk_size = OPTPARSE_LIST_CHUNK_SIZE;
+                }
+            }
+            if (chunk_size == 0 && opt->arg_storage_capacity
+                    && opt->arg_storage && ctx->values == NULL) {
+                list_array = opt->arg_storage;
+                capacity = opt->arg_storage_capacity;
+            }
+
+            if (strtoarr(ctx, opt, arg, &list_array, &list_size,
+                    opt->arg_delim, opt->arg_data_type, chunk_size,
+                    capacity)) {
+                if (oarg != arg) {
+                    ctx_free(ctx, oarg);
+                }
+                return;
+            }
+        } else
+#endif
+        if (opt->arg_data_type) { // Option-argument is a single value.
+            int ret;
+            ret = strtox(arg, &conv_arg, opt->arg_data_type);
+            if (ret) {
+                report_error(ctx, (struct optparse_error) {
+                    .type = ret == 1 ? ERROR_TYPE_INVALID_ARGUMENT
+                        : ERROR_TYPE_OUT_OF_RANGE,
+                    .token = arg,
+                    .opt = opt,
+                });
+                return;
+            }
+        }
+    }
+
+    // In batch mode, only the option's value slot is modified.
+    if (ctx->values) {
+#if OPTPARSE_LIST_SUPPORT
+        store_value(ctx, opt, arg, &conv_arg, list_array, list_size);
+#else
+        store_value(ctx, opt, arg, &conv_arg, NULL, 0);
+#endif
+        return;
+    }
+
+    // Set option's flag.
+    if (opt->flag != NULL) {
+        set_flag(opt->flag, opt->flag_type);
+    }
+
+    if (arg) {
+        // Store the (type-converted) option-argument...
+        if (opt->arg_storage) {
+#if OPTPARSE_LIST_SUPPORT
+            if (opt->arg_delim) {
+                if (opt->arg_storage_capacity == 0) {
+                    *(void **) opt->arg_storage = list_array;
+                }
+            } else
+#endif
+            if (opt->arg_data_type == DATA_TYPE_STR) {
+                *(char **) opt->arg_storage = arg;
+            } else {
+                size_t n = get_data_type_size(opt->arg_data_type);
+                memcpy(opt->arg_storage, &conv_arg, n);
+            }
+        }
+    }
+
+#if OPTPARSE_LIST_SUPPORT
+    // Store the storage size.
+    if (opt->arg_delim && opt->arg_storage_size) {
+        *opt->arg_storage_size = list_size;
+    }
+#endif
+
+    // Call option's function.
+    if (opt->function) {
+        switch (opt->function_type) {
+            case FUNCTION_TYPE_AUTO:
+                if (opt->arg_name) {
+#if OPTPARSE_LIST_SUPPORT
+                    if (opt->arg_delim) {
+                        goto type_targ_array;
+                    } else
+#endif
+                    goto type_targ;
+                } else {
+                    goto type_void;
+                }
+            case FUNCTION_TYPE_OARG:
+#if OPTPARSE_LIST_SUPPORT
+                ((void (*)(char *)) opt->function)(oarg);
+#else
+                ((void (*)(char *)) opt->function)(arg);
+#endif
+                break;
+            case FUNCTION_TYPE_TARG:
+                type_targ:
+                if (opt->arg_data_type == DATA_TYPE_STR) {
+                    conv_arg.t_str = arg;
+                }
+                call_targ(opt->function, opt->arg_data_type, &conv_arg);
+                break;
+#if OPTPARSE_LIST_SUPPORT
+            case FUNCTION_TYPE_OARG_ARRAY:
+                {
+                    char **array;
+                    size_t size;
+                    if (strtoarr(ctx, opt, oarg, (void *) &array, &size,
+                            opt->arg_delim, DATA_TYPE_STR, 0, 0)) {
+                        break;
+                    }
+                    ((void (*)(size_t, char **)) opt->function)(size, array);
+                    ctx_free(ctx, array);
+                }
+                break;
+            case FUNCTION_TYPE_TARG_ARRAY:
+                type_targ_array:
+                call_targ_array(opt->function, opt->arg_data_type, list_size,
+                    list_array);
+                break;
+            case FUNCTION_TYPE_TARG_EACH:
+            case FUNCTION_TYPE_TARG_CHUNK:
+                break; // The items have been passed while converting.
+#endif
+            case FUNCTION_TYPE_VOID:
+                type_void:
+                ((void (*)(void)) opt->function)();
+                break;
+        }
+    }
+
+#if OPTPARSE_LIST_SUPPORT
+    // List-related clean-up.
+    if (opt->arg_delim && !opt->arg_storage) {
+        ctx_free(ctx, list_array);
+    }
+    if (oarg != arg) {
+        ctx_free(ctx, oarg);
+    }
+#endif
+}
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+// Prints a mutually exclusive option's name ("-o, --option") to a buffer.
+static void bprint_option_name(char *buffer, struct optparse_opt *opt)
+{
+    if (opt->short_name) {
+        bprintf(buffer, "-%c", opt->short_name);
+#if OPTPARSE_LONG_OPTIONS
+        if (opt->long_name) {
+            bprintf(buffer, ", ");
+        }
+#endif
+    }
+
+#if OPTPARSE_LONG_OPTIONS
+    if (opt->long_name) {
+        bprintf(buffer, "--%s", opt->long_name);
+    }
+#endif
+}
+
+// The largest group value for which the groups used in a parsing run are
+// tracked on the stack; larger ones need memory from the context's allocator.
+#define GROUPS_STACK_MAX 255
+
+// Returns the next group an option belongs to (counting .group first, then
+// .groups), or 0 if there are no more. Group values below 1 are ignored.
+// i: the iteration's state, which must be 0 initially
+static int next_option_group(struct optparse_opt *opt, int *i)
+{
+    if (*i == 0) {
+        (*i)++;
+        if (opt->group > 0) {
+            return opt->group;
+        }
+    }
+    if (opt->groups) {
+        while (opt->groups[*i - 1]) {
+            int group = opt->groups[(*i)++ - 1];
+            if (group > 0) {
+                return group;
+            }
+        }
+    }
+    return 0;
+}
+
+// Returns whether a group is tracked in the current parsing run, i.e. whether
+// it is a valid group value (group values may have been changed since the
+// command tree was compiled).
+static int is_tracked_group(struct optparse_ctx *ctx, int group)
+{
+    return group > 0 && group <= ctx->max_group;
+}
+
+// Returns whether a group is set in a bit set of groups.
+static int has_group(const unsigned char *groups, int group)
+{
+    return groups[group / CHAR_BIT] & (1 << (group % CHAR_BIT));
+}
+
+// Returns the option that has been used in one of an option's groups, or NULL
+// if there is none.
+static struct optparse_opt *find_conflicting_option(struct optparse_ctx *ctx,
+    struct optparse_opt *opt)
+{
+    if (is_tracked_group(ctx, opt->group)
+        && has_group(ctx->groups_seen, opt->group)) {
+        return ctx->group_opts[opt->group];
+    }
+    if (opt->groups) {
+        for (int *group = opt->groups; *group; group++) {
+            if (is_tracked_group(ctx, *group)
+                && has_group(ctx->groups_seen, *group)) {
+                return ctx->group_opts[*group];
+            }
+        }
+    }
+    return NULL;
+}
+
+// Marks a group as used by an option.
+static void claim_group(struct optparse_ctx *ctx, struct optparse_opt *opt,
+    int group)
+{
+    ctx->groups_seen[group / CHAR_BIT] |= 1 << (group % CHAR_BIT);
+    ctx->group_opts[group] = opt;
+}
+
+// Marks an option's groups as used by the option.
+static void claim_groups(struct optparse_ctx *ctx, struct optparse_opt *opt)
+{
+    if (is_tracked_group(ctx, opt->group)) {
+        claim_group(ctx, opt, opt->group);
+    }
+    if (opt->groups) {
+        for (int *group = opt->groups; *group; group++) {
+            if (is_tracked_group(ctx, *group)) {
+                claim_group(ctx, opt, *group);
+            }
+        }
+    }
+}
+
+// Checks an option for mutual exclusivity violations and reports them.
+// Return value: 0 if the option may be used, otherwise 1.
+static int check_mutual_exclusivity(struct optparse_ctx *ctx,
+    struct optparse_opt *opt)
+{
+    if (!opt->group && !opt->groups) {
+        return 0;
+    }
+
+    struct optparse_opt *conflicting_opt = find_conflicting_option(ctx, opt);
+    if (conflicting_opt) {
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_MUTUALLY_EXCLUSIVE,
+            .opt = opt,
+            .conflicting_opt = conflicting_opt,
+        });
+        return 1;
+    }
+
+    claim_groups(ctx, opt);
+    return 0;
+}
+
+// Computes the largest group value in a command's subtree.
+static int find_max_group(struct optparse_cmd *cmd)
+{
+    int max_group = 0;
+    if (cmd->options) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            int group;
+            for (int i = 0; (group = next_option_group(opt, &i));) {
+                if (group > max_group) {
+                    max_group = group;
+                }
+            }
+            opt++;
+        }
+    }
+
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            int group = subcmd->_index ? subcmd->_index->max_group
+                : find_max_group(subcmd);
+            if (group > max_group) {
+                max_group = group;
+            }
+            subcmd++;
+        }
+    }
+#endif
+
+    return max_group;
+}
+
+// Returns the largest group value in a command's subtree, which is computed
+// when the command tree is compiled.
+static int get_max_group(struct optparse_cmd *cmd)
+{
+    return cmd->_index ? cmd->_index->max_group : find_max_group(cmd);
+}
+
+// Prepares tracking the groups used in a parsing run. Up to GROUPS_STACK_MAX,
+// the caller's buffers are used; beyond that, memory is allocated with the
+// context's allocator and has to be released with release_groups().
+// Return value: 0 on success, otherwise 1 (the error has been reported)
+static int init_groups(struct optparse_ctx *ctx, struct optparse_cmd *cmd,
+    unsigned char *seen_buffer, struct optparse_opt **opts_buffer)
+{
+    ctx->max_group = get_max_group(cmd);
+    ctx->groups_seen = seen_buffer;
+    ctx->group_opts = opts_buffer;
+
+    if (ctx->max_group > GROUPS_STACK_MAX) {
+        size_t n = (size_t) ctx->max_group + 1;
+        ctx->group_opts = ctx_malloc(ctx,
+            n * sizeof *ctx->group_opts + n / CHAR_BIT + 1);
+        if (ctx->group_opts == NULL) {
+            ctx->max_group = 0;
+            ctx->group_opts = opts_buffer;
+            report_error(ctx, (struct optparse_error) {
+                .type = ERROR_TYPE_OUT_OF_MEMORY });
+            return 1;
+        }
+        ctx->groups_seen = (unsigned char *) (ctx->group_opts + n);
+    }
+
+    // group_opts needn't be initialized.
+    memset(ctx->groups_seen, 0, (size_t) ctx->max_group / CHAR_BIT + 1);
+    return 0;
+}
+
+// Releases the memory allocated by init_groups(), if any.
+static void release_groups(struct optparse_ctx *ctx,
+    struct optparse_opt **opts_buffer)
+{
+    if (ctx->group_opts != opts_buffer) {
+        ctx_free(ctx, ctx->group_opts);
+    }
+    ctx->groups_seen = NULL;
+    ctx->group_opts = NULL;
+}
+#endif
+
+/// Private "lookup" functions -------------------------------------------------
+
+#if USE_HASH_TABLES || (OPTPARSE_COMPILED_TREES && OPTPARSE_LONG_OPTIONS)
+// Returns the hash value (FNV-1a) of a string that ends with a terminator
+// character or with '\0'. The string's length is written to *len, if not NULL.
+static size_t hash_name(const char *str, char terminator, size_t *len)
+{
+    const char *start = str;
+    size_t hash = 2166136261u;
+    while (*str != '\0' && *str != terminator) {
+        hash ^= (unsigned char) *str++;
+        hash *= 16777619u;
+    }
+    if (len) {
+        *len = str - start;
+    }
+    return hash;
+}
+#endif
+
+#if USE_HASH_TABLES || OPTPARSE_COMPILED_TREES
+// Returns the mask of a hash table that is large enough to hold n items while
+// being at most half full.
+static size_t get_table_mask(size_t n)
+{
+    size_t size = 1;
+    while (size < 2 * n) {
+        size *= 2;
+    }
+    return size - 1;
+}
+#endif
+
+#if USE_HASH_TABLES
+// Returns a string's hash value (FNV-1a).
+static size_t hash_string(const char *str)
+{
+    return hash_name(str, '\0', NULL);
+}
+
+// Adds an item to a hash table. If the name is already taken, the table is
+// left unchanged, so that the first item wins, as it would in a linear search.
+static void table_insert(struct optparse_slot *table, size_t mask, char *name,
+    void *item)
+{
+    size_t hash = hash_string(name);
+    size_t i = hash & mask;
+    while (table[i].name) {
+        if (table[i].hash == hash && strcmp(table[i].name, name) == 0) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    table[i].hash = hash;
+    table[i].name = name;
+    table[i].item = item;
+}
+
+#if (OPTPARSE_LONG_OPTIONS && !OPTPARSE_GENERATED_PARSER) \
+    || OPTPARSE_SUBCOMMANDS
+// Returns the item a hash table associates with a name, or NULL if the name is
+// unknown.
+static void *table_find(struct optparse_slot *table, size_t mask,
+    const char *name)
+{
+    size_t hash = hash_string(name);
+    size_t i = hash & mask;
+    while (table[i].name) {
+        if (table[i].hash == hash && strcmp(table[i].name, name) == 0) {
+            return table[i].item;
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+#endif
+#endif
+
+#if OPTPARSE_ENV_VARIABLES
+// Returns the option a command's environment variable table associates with
+// an environment string ("NAME=value"), or NULL if there is none. The value is
+// written to *value.
+static struct optparse_opt *find_env_option(struct optparse_index *index,
+    char *env_var, char **value)
+{
+    size_t len;
+    size_t hash = hash_name(env_var, '=', &len);
+    if (env_var[len] != '=') {
+        return NULL;
+    }
+
+    struct optparse_slot *table = index->env_opts;
+    size_t i = hash & index->env_opts_mask;
+    while (table[i].name) {
+        if (table[i].hash == hash && strncmp(table[i].name, env_var, len) == 0
+                && table[i].name[len] == '\0') {
+            *value = env_var + len + 1;
+            return table[i].item;
+        }
+        i = (i + 1) & index->env_opts_mask;
+    }
+    return NULL;
+}
+#endif
+
+#if OPTPARSE_COMPILED_TREES
+// Returns the 32-bit unsigned integer at index i of an unaligned array.
+static uint32_t read_u32(const unsigned char *array, size_t i)
+{
+    uint32_t value;
+    memcpy(&value, array + i * sizeof value, sizeof value);
+    return value;
+}
+
+#if OPTPARSE_LONG_OPTIONS
+// Returns a command's option that has the specified long name, looked up in
+// the loaded compiled tree, or NULL if there is no such option.
+static struct optparse_opt *find_compiled_long_option(struct optparse_cmd *cmd,
+    const char *long_name)
+{
+    const struct compiled_cmd *compiled = &cmd->_index->compiled;
+    size_t len;
+    uint32_t hash = (uint32_t) hash_name(long_name, '\0', &len);
+    size_t i = hash & compiled->slots_mask;
+    uint32_t slot;
+    while ((slot = read_u32(compiled->slots, i)) != 0) {
+        size_t id = slot - 1;
+        if (read_u32(compiled->hashes, id) == hash
+                && read_u32(compiled->name_lens, id) == len
+                && memcmp(compiled->pool + read_u32(compiled->name_offsets, id),
+                    long_name, len) == 0) {
+            return &cmd->options[id];
+        }
+        i = (i + 1) & compiled->slots_mask;
+    }
+    return NULL;
+}
+#endif
+#endif
+
+// Builds a command's lookup tables. On allocation failure, cmd->_index stays
+// NULL and options are looked up by linear search instead.
+// long_opts_table: whether to build the long option table, which a loaded
+// compiled tree replaces
+static void build_index(struct optparse_cmd *cmd, _Bool long_opts_table)
+{
+    size_t size = sizeof (struct optparse_index);
+#if OPTPARSE_LONG_OPTIONS && !OPTPARSE_GENERATED_PARSER
+    size_t n_long_opts = 0;
+    if (cmd->options && long_opts_table) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            if (opt->long_name) {
+                n_long_opts++;
+            }
+            opt++;
+        }
+    }
+    size_t long_opts_mask = get_table_mask(n_long_opts);
+    size += (long_opts_mask + 1) * sizeof (struct optparse_slot);
+#endif
+#if OPTPARSE_SUBCOMMANDS
+    size_t n_subcmds = 0;
+    if (cmd->subcommands) {
+        while (cmd->subcommands[n_subcmds].name != END_OF_SUBCOMMANDS) {
+            n_subcmds++;
+        }
+    }
+    size_t subcmds_mask = get_table_mask(n_subcmds);
+    size += (subcmds_mask + 1) * sizeof (struct optparse_slot);
+#endif
+#if OPTPARSE_ENV_VARIABLES
+    size_t n_env_opts = 0;
+    if (cmd->options) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            if (opt->env_name) {
+                n_env_opts++;
+            }
+            opt++;
+        }
+    }
+    size_t env_opts_mask = get_table_mask(n_env_opts);
+    if (n_env_opts) {
+        size += (env_opts_mask + 1) * sizeof (struct optparse_slot);
+    }
+#endif
+
+#if OPTPARSE_NO_HEAP
+    (void) size;
+    struct optparse_index *index = NULL; // Options are searched linearly.
+#else
+    struct optparse_index *index = calloc(1, size);
+#endif
+    if (index == NULL) {
+        return;
+    }
+#if USE_HASH_TABLES
+    struct optparse_slot *slots = (struct optparse_slot *) (index + 1);
+#endif
+#if OPTPARSE_LONG_OPTIONS && !OPTPARSE_GENERATED_PARSER
+    index->long_opts_mask = long_opts_mask;
+    index->long_opts = slots;
+    slots += long_opts_mask + 1;
+#endif
+#if OPTPARSE_SUBCOMMANDS
+    index->subcmds_mask = subcmds_mask;
+    index->subcmds = slots;
+    slots += subcmds_mask + 1;
+#endif
+#if OPTPARSE_ENV_VARIABLES
+    if (n_env_opts) {
+        index->env_opts_mask = env_opts_mask;
+        index->env_opts = slots;
+    }
+#endif
+
+#if OPTPARSE_GENERATED_PARSER
+    (void) long_opts_table; // Generated code looks up options.
+#else
+    if (cmd->options) {
+        // Walk the array backwards, so that the first of several options with
+        // the same short name wins, as it would in a linear search.
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            opt++;
+        }
+        while (opt-- != cmd->options) {
+            if (opt->short_name) {
+                index->short_opts[(unsigned char) opt->short_name] = opt;
+            }
+        }
+
+#if OPTPARSE_LONG_OPTIONS
+        opt = cmd->options;
+        while (long_opts_table && opt->short_name != (char) END_OF_OPTIONS) {
+            if (opt->long_name) {
+                table_insert(index->long_opts, long_opts_mask, opt->long_name,
+                    opt);
+            }
+            opt++;
+        }
+#else
+        (void) long_opts_table;
+#endif
+    }
+#endif
+
+#if OPTPARSE_ENV_VARIABLES
+    if (cmd->options) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            if (opt->env_name) {
+                table_insert(index->env_opts, env_opts_mask, opt->env_name,
+                    opt);
+            }
+            opt++;
+        }
+    }
+#endif
+
+#if OPTPARSE_SUBCOMMANDS
+    for (size_t i = 0; i < n_subcmds; i++) {
+        struct optparse_cmd *subcmd = &cmd->subcommands[i];
+        table_insert(index->subcmds, subcmds_mask, subcmd->name, subcmd);
+    }
+#endif
+
+    cmd->_index = index;
+}
+
+// Returns a command's option that has the specified short name, or NULL if
+// there is no such option.
+static struct optparse_opt *find_short_option(struct optparse_cmd *cmd,
+    char short_name)
+{
+    if (cmd->_index) {
+#if OPTPARSE_GENERATED_PARSER
+        int id = cmd->_index->generated->find_short(short_name);
+        return id < 0 ? NULL : &cmd->options[id];
+#else
+        return cmd->_index->short_opts[(unsigned char) short_name];
+#endif
+    }
+
+    if (cmd->options) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            if (opt->short_name == short_name) {
+                return opt;
+            }
+            opt++;
+        }
+    }
+    return NULL;
+}
+
+#if OPTPARSE_LONG_OPTIONS
+// Returns a command's option that has the specified long name, or NULL if there
+// is no such option.
+static struct optparse_opt *find_long_option(struct optparse_cmd *cmd,
+    const char *long_name)
+{
+    if (cmd->_index) {
+#if OPTPARSE_COMPILED_TREES
+        if (cmd->_index->compiled.slots) {
+            return find_compiled_long_option(cmd, long_name);
+        }
+#endif
+#if OPTPARSE_GENERATED_PARSER
+        int id = cmd->_index->generated->find_long(long_name);
+        return id < 0 ? NULL : &cmd->options[id];
+#else
+        return table_find(cmd->_index->long_opts, cmd->_index->long_opts_mask,
+            long_name);
+#endif
+    }
+
+    if (cmd->options) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            if (opt->long_name && strcmp(long_name, opt->long_name) == 0) {
+                return opt;
+            }
+            opt++;
+        }
+    }
+    return NULL;
+}
+#endif
+
+#if OPTPARSE_SUBCOMMANDS
+// Returns a command's subcommand that has the specified name, or NULL if there
+// is no such subcommand.
+static struct optparse_cmd *find_subcommand(struct optparse_cmd *cmd,
+    const char *name)
+{
+    if (cmd->_index) {
+        return table_find(cmd->_index->subcmds, cmd->_index->subcmds_mask,
+            name);
+    }
+
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            if (strcmp(name, subcmd->name) == 0) {
+                return subcmd;
+            }
+            subcmd++;
+        }
+    }
+    return NULL;
+}
+#endif
+
+// Reads the next shell-style word from a string, in place. As quotes and
+// backslashes are removed, the word is written to the same string, trailing
+// behind the read position.
+// string: the read position, which is advanced past the word
+// malformed: set to true if the word has an unterminated quote or a trailing
+//            backslash
+// Return value: the zero-terminated word; NULL if there are no more words or
+// the word is malformed
+static char *next_word(char **string, _Bool *malformed)
+{
+    char *in = *string;
+    while (*in == ' ' || (*in >= '\t' && *in <= '\r')) {
+        in++;
+    }
+    if (*in == '\0') {
+        *string = in;
+        return NULL;
+    }
+
+    char *word = in;
+    char *out = in;
+    char quote = '\0'; // The currently open quote character, if any.
+    while (1) {
+        char c = *in++;
+        if (c == '\0') {
+            if (quote) {
+                *malformed = true;
+                return NULL;
+            }
+            in--; // To let the next call find the end of the string.
+            break;
+        } else if (quote == '\'') {
+            if (c == quote) {
+                quote = '\0';
+            } else {
+                *out++ = c;
+            }
+        } else if (c == '\\') {
+            if (*in == '\0') {
+                *malformed = true;
+                return NULL;
+            }
+            if (quote == '"' && !strchr("\"\\$`\n", *in)) {
+                *out++ = c; // Backslash has no special meaning.
+            } else if (*in == '\n') {
+                in++; // Line continuation
+            } else {
+                *out++ = *in++;
+            }
+        } else if (quote == '"') {
+            if (c == quote) {
+                quote = '\0';
+            } else {
+                *out++ = c;
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            break;
+        } else {
+            *out++ = c;
+        }
+    }
+    *out = '\0';
+
+    *string = in;
+    return word;
+}
+
+#if OPTPARSE_RESPONSE_FILES || (OPTPARSE_CONFIG_FILES && OPTPARSE_LONG_OPTIONS)
+// Loads a response or configuration file into writable, zero-terminated
+// memory, which is never released, as arguments read from the file point into
+// it. If possible, the file is mapped into memory instead of being copied,
+// unless the context tracks its allocations, which optparse_free_all() must
+// be able to release.
+// Return value: the file's content; NULL if the file could not be read
+static char *load_file(struct optparse_ctx *ctx, const char *path)
+{
+#if USE_MMAP
+    if (!ctx->track_allocations) {
+        int fd = open(path, O_RDONLY);
+        if (fd == -1) {
+            return NULL;
+        }
+
+        // Beyond the file's end, the rest of the last page reads as zeros,
+        // which terminates the string. Files filling whole pages are read
+        // instead.
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+                && st.st_size % sysconf(_SC_PAGESIZE) != 0) {
+            char *map = mmap(NULL, st.st_size + 1, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE, fd, 0);
+            close(fd);
+            return map == MAP_FAILED ? NULL : map;
+        }
+        close(fd);
+    }
+#endif
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    char *content = NULL;
+    size_t size = 0;
+    size_t capacity = 4096;
+    while (1) {
+        char *ret = ctx_realloc(ctx, content, capacity + 1);
+        if (ret == NULL) {
+            ctx_free(ctx, content);
+            fclose(file);
+            return NULL;
+        }
+        content = ret;
+
+        size_t n = fread(content + size, 1, capacity - size, file);
+        size += n;
+        if (size < capacity) {
+            break;
+        }
+        capacity *= 2;
+    }
+
+    if (ferror(file)) {
+        ctx_free(ctx, content);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+
+    content[size] = '\0';
+    return content;
+}
+#endif
+
+#if OPTPARSE_RESPONSE_FILES
+// If the argument at args[index] names a response file ("@FILE"), replaces it
+// with the arguments read from that file, which are split like by
+// optparse_tokenize().
+// Return value: 0 if the argument has been replaced; 1 if it is to be taken
+// literally, because it does not name a readable file or an error occurred
+static int expand_response_file(struct optparse_ctx *ctx, int index)
+{
+    char *arg = ctx->args[index];
+    if (arg == NULL || arg[0] != '@' || arg[1] == '\0') {
+        return 1;
+    }
+
+    // Guard against response files that include themselves.
+    if (ctx->n_response_files == OPTPARSE_RESPONSE_FILES_MAX) {
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_RESPONSE_FILE, .token = arg + 1 });
+        return 1;
+    }
+
+    char *content = load_file(ctx, arg + 1);
+    if (content == NULL) {
+        return 1;
+    }
+
+    int n_after = 0;
+    while (ctx->args[index + 1 + n_after]) {
+        n_after++;
+    }
+
+    // Create a new argument array: previous arguments, arguments read from the
+    // file, and following arguments.
+    size_t capacity = index + n_after + 16;
+    char **args = ctx_malloc(ctx, capacity * sizeof(*args));
+    if (args == NULL) {
+        goto out_of_memory;
+    }
+    memcpy(args, ctx->args, index * sizeof(*args));
+    size_t size = index;
+    _Bool malformed = false;
+    char *word;
+    while ((word = next_word(&content, &malformed)) != NULL) {
+        if (size + n_after + 1 > capacity) {
+            capacity *= 2;
+            char **ret = ctx_realloc(ctx, args, capacity * sizeof(*args));
+            if (ret == NULL) {
+                ctx_free(ctx, args);
+                goto out_of_memory;
+            }
+            args = ret;
+        }
+        args[size++] = word;
+    }
+    if (malformed) {
+        ctx_free(ctx, args);
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_RESPONSE_FILE, .token = arg + 1 });
+        return 1;
+    }
+    memcpy(args + size, ctx->args + index + 1,
+        (n_after + 1) * sizeof(*args));
+
+    // Previous arrays created here are no longer referenced.
+    if (ctx->n_response_files) {
+        ctx_free(ctx, ctx->args);
+    }
+    ctx->args = args;
+    ctx->n_response_files++;
+    return 0;
+
+    out_of_memory:
+    report_error(ctx, (struct optparse_error) {
+        .type = ERROR_TYPE_OUT_OF_MEMORY });
+    return 1;
+}
+#endif
+
+#if OPTPARSE_LONG_OPTIONS
+// Identifies and executes a single known long option.
+static void execute_long_option(struct optparse_ctx *ctx, char *long_name,
+    struct optparse_cmd *cmd)
+{
+#if OPTPARSE_ATTACHED_OPTION_ARGUMENTS
+    char *arg = strchr(long_name, '=');
+    if (arg) {
+        *arg++ = '\0';
+    }
+#else
+    char *arg = NULL;
+#endif
+
+    struct optparse_opt *opt = find_long_option(cmd, long_name);
+    if (opt == NULL) {
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_UNKNOWN_OPTION, .token = long_name });
+        return;
+    }
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    int excluded = check_mutual_exclusivity(ctx, opt);
+#endif
+    if (arg) {
+        if (!opt->arg_name) {
+            report_error(ctx, (struct optparse_error) {
+                .type = ERROR_TYPE_UNWANTED_ARGUMENT, .token = arg,
+                .opt = opt });
+            return;
+        }
+    } else if (opt->arg_name && opt->arg_name[0] != '[') {
+#if OPTPARSE_RESPONSE_FILES
+        while (expand_response_file(ctx, ctx->args_index + 1) == 0);
+#endif
+        if (ctx->args[ctx->args_index + 1] == NULL) {
+            report_error(ctx, (struct optparse_error) {
+                .type = ERROR_TYPE_MISSING_ARGUMENT, .token = long_name,
+                .opt = opt });
+            return;
+        }
+        arg = ctx->args[++ctx->args_index];
+    }
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    if (excluded) {
+        return;
+    }
+#endif
+    execute_option(ctx, opt, arg);
+}
+#endif
+
+// Identifies and executes a group of known short options.
+// option_group must not be NULL.
+static void execute_short_option(struct optparse_ctx *ctx, char *option_group,
+    struct optparse_cmd *cmd)
+{
+    char *c = option_group + 1;
+
+    while (*c != '\0') {
+        char *arg = c + 1;
+        if (*arg == '\0') {
+            arg = NULL;
+        }
+
+        struct optparse_opt *opt = find_short_option(cmd, *c);
+        if (opt == NULL) {
+            report_error(ctx, (struct optparse_error) {
+                .type = ERROR_TYPE_UNKNOWN_OPTION, .token = c });
+            c++;
+            continue;
+        }
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+        int excluded = check_mutual_exclusivity(ctx, opt);
+#endif
+        if (arg) {
+#if OPTPARSE_ATTACHED_OPTION_ARGUMENTS
+            if (!opt->arg_name) {
+                arg = NULL;
+            }
+#else
+            if (opt->arg_name) {
+                report_error(ctx, (struct optparse_error) {
+                    .type = ERROR_TYPE_MISSING_ARGUMENT, .token = c,
+                    .opt = opt });
+                c++;
+                continue;
+            } else {
+                arg = NULL;
+            }
+#endif
+        } else if (opt->arg_name && opt->arg_name[0] != '[') {
+#if OPTPARSE_RESPONSE_FILES
+            while (expand_response_file(ctx, ctx->args_index + 1) == 0);
+#endif
+            if (ctx->args[ctx->args_index + 1] == NULL) {
+                report_error(ctx, (struct optparse_error) {
+                    .type = ERROR_TYPE_MISSING_ARGUMENT, .token = c,
+                    .opt = opt });
+                return;
+            }
+            arg = ctx->args[++ctx->args_index];
+        }
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+        if (!excluded)
+#endif
+            execute_option(ctx, opt, arg);
+        if (arg || ctx->stopped) {
+            return;
+        }
+
+        c++;
+    }
+}
+
+#if OPTPARSE_ENV_VARIABLES
+// Executes an option whose environment variable is set.
+static void execute_env_option(struct optparse_ctx *ctx,
+    struct optparse_opt *opt, char *env_var, char *value)
+{
+    // Options without option-arguments are used unless the value is "" or "0".
+    if (opt->arg_name == NULL
+            && (value[0] == '\0' || strcmp(value, "0") == 0)) {
+        return;
+    }
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    // Options used on the command line take precedence over conflicting
+    // environment variables.
+    if (find_conflicting_option(ctx, opt)) {
+        return;
+    }
+    claim_groups(ctx, opt);
+#endif
+
+    // Lists are split in place and strings are stored, so their
+    // option-argument is a copy, as the environment must not be altered.
+    // Other values are only read. An empty value omits optional
+    // option-arguments.
+    char *arg = NULL;
+    if (opt->arg_name && (value[0] != '\0' || opt->arg_name[0] != '[')) {
+        arg = value;
+#if OPTPARSE_LIST_SUPPORT
+        _Bool copy = opt->arg_delim || opt->arg_data_type == DATA_TYPE_STR;
+#else
+        _Bool copy = opt->arg_data_type == DATA_TYPE_STR;
+#endif
+        if (copy) {
+            arg = ctx_malloc(ctx, strlen(value) + 1);
+            if (arg == NULL) {
+                report_error(ctx, (struct optparse_error) {
+                    .type = ERROR_TYPE_OUT_OF_MEMORY, .arg = env_var,
+                    .index = -1, .opt = opt });
+                return;
+            }
+            strcpy(arg, value);
+        }
+    }
+
+    ctx->env_var = env_var;
+    execute_option(ctx, opt, arg);
+    ctx->env_var = NULL;
+}
+
+// Uses environment variables for the command's options that have an
+// .env_name and have not been used on the command line, in a single pass over
+// the environment.
+static void parse_env_vars(struct optparse_ctx *ctx, struct optparse_cmd *cmd)
+{
+    if (ctx->env_seen == NULL) {
+        return;
+    }
+
+    for (char **env = environ; *env && !ctx->stopped; env++) {
+        char *value = NULL;
+        struct optparse_opt *opt = NULL;
+        if (cmd->_index) {
+            opt = find_env_option(cmd->_index, *env, &value);
+        } else { // Linear search
+            for (opt = cmd->options; opt->short_name != (char) END_OF_OPTIONS;
+                    opt++) {
+                size_t len = opt->env_name ? strlen(opt->env_name) : 0;
+                if (len && strncmp(*env, opt->env_name, len) == 0
+                        && (*env)[len] == '=') {
+                    value = *env + len + 1;
+                    break;
+                }
+            }
+            if (value == NULL) {
+                opt = NULL;
+            }
+        }
+
+        if (opt && !ctx->env_seen[opt - cmd->options]) {
+            ctx->env_seen[opt - cmd->options] = true;
+            execute_env_option(ctx, opt, *env, value);
+        }
+    }
+
+    ctx_free(ctx, ctx->env_seen);
+    ctx->env_seen = NULL;
+}
+
+// Prepares tracking which of the command's options are used on the command
+// line, if it has options with an .env_name.
+static void track_env_options(struct optparse_ctx *ctx,
+    struct optparse_cmd *cmd)
+{
+    ctx->env_seen = NULL;
+
+    _Bool has_env_opts = false;
+    if (cmd->_index) {
+        has_env_opts = cmd->_index->env_opts != NULL;
+    } else if (cmd->options) {
+        for (struct optparse_opt *opt = cmd->options;
+                opt->short_name != (char) END_OF_OPTIONS; opt++) {
+            if (opt->env_name) {
+                has_env_opts = true;
+            }
+        }
+    }
+
+    if (has_env_opts) {
+        size_t size = count_own_options(cmd) * sizeof(_Bool);
+        ctx->env_seen = ctx_malloc(ctx, size);
+        if (ctx->env_seen) {
+            memset(ctx->env_seen, 0, size);
+        } else {
+            report_error(ctx, (struct optparse_error) {
+                .type = ERROR_TYPE_OUT_OF_MEMORY });
+        }
+    }
+}
+#endif
+
+// Parses a command's command line options.
+// After parsing, only operands remain in argv.
+static void parse(struct optparse_ctx *ctx, int *argc, char ***argv,
+    struct optparse_cmd *cmd)
+{
+    ctx->args = *argv;
+    ctx->args_index = 1;
+    *argc = 1; // To keep argv[0].
+    ctx->active_cmd = cmd;
+#if OPTPARSE_ENV_VARIABLES
+    track_env_options(ctx, cmd);
+#endif
+
+    int ignore_options = 0;
+    char *arg;
+    while ((arg = ctx->args[ctx->args_index]) != NULL) {
+#if OPTPARSE_RESPONSE_FILES
+        // Response files are expanded when they are reached.
+        if (!ignore_options && expand_response_file(ctx, ctx->args_index)
+                == 0) {
+            continue;
+        }
+#endif
+
+        if (!ignore_options && arg[0] == '-') { // Option
+            if (arg[1] == '-') {
+                if (arg[2] == '\0') { // Stand-alone option "--"
+                    ignore_options = 1;
+#if OPTPARSE_LONG_OPTIONS
+                } else { // Long option
+                    execute_long_option(ctx, arg + 2, cmd);
+#endif
+                }
+            } else { // Short option
+                execute_short_option(ctx, arg, cmd);
+            }
+
+            if (ctx->stopped) {
+#if OPTPARSE_ENV_VARIABLES
+                ctx_free(ctx, ctx->env_seen);
+                ctx->env_seen = NULL;
+#endif
+                ctx->args[*argc] = NULL;
+                *argv = ctx->args;
+                return;
+            }
+        } else { // Operand or subcommand
+#if OPTPARSE_SUBCOMMANDS
+            if (cmd->subcommands) {
+                struct optparse_cmd *subcmd = find_subcommand(cmd, arg);
+                if (subcmd == NULL) {
+                    report_error(ctx, (struct optparse_error) {
+                        .type = ERROR_TYPE_UNKNOWN_COMMAND, .token = arg });
+                    break;
+                }
+
+#if OPTPARSE_ENV_VARIABLES
+                // The command's options are complete.
+                parse_env_vars(ctx, cmd);
+                if (ctx->stopped) {
+                    ctx->args[*argc] = NULL;
+                    *argv = ctx->args;
+                    return;
+                }
+#endif
+
+                // Remove previous arguments, including the subcommand, from
+                // argv (args will be set in the next iteration).
+                ctx->args_offset += ctx->args_index;
+                do {
+                    ctx->args[(*argc)++] = ctx->args[++ctx->args_index];
+                } while (ctx->args[ctx->args_index]);
+                ctx->args[*argc] = NULL;
+                *argv = ctx->args;
+
+                // Continue parsing with the subcommand.
+                parse(ctx, argc, argv, subcmd);
+
+                return;
+            } else
+#endif
+                // Treat argument as an operand, adding it to the new argv.
+                ctx->args[(*argc)++] = arg;
+        }
+
+        // Can be NULL due to optparse_shift().
+        if (ctx->args[ctx->args_index] != NULL) {
+            ctx->args_index++;
+        }
+    }
+
+    ctx->args[*argc] = NULL;
+    *argv = ctx->args;
+
+#if OPTPARSE_ENV_VARIABLES
+    parse_env_vars(ctx, cmd);
+    if (ctx->stopped) {
+        return;
+    }
+#endif
+
+    // Run command's function on remaining operands.
+    if (cmd->function && ctx->n_errors == 0 && ctx->values == NULL) {
+        ctx->args_index = 0;
+        cmd->function(*argc, *argv);
+    }
+
+}
+
+#if OPTPARSE_CONFIG_FILES && OPTPARSE_LONG_OPTIONS
+// Removes leading and trailing whitespace from a string, in place.
+static char *trim(char *str)
+{
+    while (isspace((unsigned char) *str)) {
+        str++;
+    }
+    char *end = str + strlen(str);
+    while (end > str && isspace((unsigned char) end[-1])) {
+        end--;
+    }
+    *end = '\0';
+    return str;
+}
+
+// Parses a configuration file's section header ("[COMMAND SUBCOMMAND...]").
+// Return value: the command the section belongs to; NULL if it is unknown
+static struct optparse_cmd *parse_config_section(struct optparse_ctx *ctx,
+    char *header)
+{
+    char *end = strchr(header, ']');
+    if (end == NULL || trim(end + 1)[0] != '\0') {
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_INVALID_ARGUMENT, .token = header });
+        return NULL;
+    }
+    *end = '\0';
+
+    // Each word names a subcommand of the previous word's command.
+    struct optparse_cmd *cmd = ctx->main_cmd;
+    char *word = header + 1;
+    while (1) {
+        while (isspace((unsigned char) *word)) {
+            word++;
+        }
+        if (*word == '\0') {
+            return cmd;
+        }
+        char *word_end = word;
+        while (*word_end != '\0' && !isspace((unsigned char) *word_end)) {
+            word_end++;
+        }
+        char c = *word_end;
+        *word_end = '\0';
+
+#if OPTPARSE_SUBCOMMANDS
+        struct optparse_cmd *subcmd = find_subcommand(cmd, word);
+#else
+        struct optparse_cmd *subcmd = NULL;
+#endif
+        if (subcmd == NULL) {
+            report_error(ctx, (struct optparse_error) {
+                .type = ERROR_TYPE_UNKNOWN_COMMAND, .token = word });
+            return NULL;
+        }
+        cmd = subcmd;
+
+        if (c == '\0') {
+            return cmd;
+        }
+        word = word_end + 1;
+    }
+}
+
+// Parses a configuration file's "key = value" line, executing the active
+// command's option whose long name is the key.
+static void parse_config_value(struct optparse_ctx *ctx, char *key)
+{
+    char *value = strchr(key, '=');
+    if (value) {
+        *value++ = '\0';
+        key = trim(key);
+        value = trim(value);
+
+        // Remove quotes around the value.
+        size_t len = strlen(value);
+        if (len >= 2 && (value[0] == '"' || value[0] == '\'')
+                && value[len - 1] == value[0]) {
+            value[len - 1] = '\0';
+            value++;
+        }
+    }
+
+    struct optparse_opt *opt = find_long_option(ctx->active_cmd, key);
+    if (opt == NULL) {
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_UNKNOWN_OPTION, .token = key });
+        return;
+    }
+
+    char *arg = NULL;
+    if (opt->arg_name == NULL) {
+        // Options without option-arguments are used if their value is true.
+        if (value) {
+            _Bool used;
+            int ret = strtox(value, &used, DATA_TYPE_BOOL);
+            if (ret) {
+                report_error(ctx, (struct optparse_error) {
+                    .type = ret == 1 ? ERROR_TYPE_INVALID_ARGUMENT
+                        : ERROR_TYPE_OUT_OF_RANGE,
+                    .token = value,
+                    .opt = opt,
+                });
+                return;
+            }
+            if (!used) {
+                return;
+            }
+        }
+    } else if (value && (value[0] != '\0' || opt->arg_name[0] != '[')) {
+        arg = value;
+    } else if (opt->arg_name[0] != '[') {
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_MISSING_ARGUMENT, .token = key, .opt = opt });
+        return;
+    }
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    if (check_mutual_exclusivity(ctx, opt)) {
+        return;
+    }
+#endif
+    execute_option(ctx, opt, arg);
+}
+
+// Parses a configuration file's content, in place and in a single pass.
+static void parse_config(struct optparse_ctx *ctx, char *content)
+{
+    char *line = content;
+    ctx->config_line = 0;
+    while (line && !ctx->stopped) {
+        ctx->config_line++;
+        char *next = strchr(line, '\n');
+        if (next) {
+            *next++ = '\0';
+        }
+
+        line = trim(line);
+        if (line[0] == '[') {
+            struct optparse_cmd *cmd = parse_config_section(ctx, line);
+            // Lines of unknown sections are skipped.
+            ctx->active_cmd = cmd;
+        } else if (line[0] != '\0' && line[0] != '#' && line[0] != ';'
+                && ctx->active_cmd) {
+            parse_config_value(ctx, line);
+        }
+
+        line = next;
+    }
+}
+#endif
+
+/// Private "help screen" functions --------------------------------------------
+
+#if !OPTPARSE_HELP_PRERENDERED
+// Text is rendered into a buffer first, so that a help screen can be cached and
+// written with a single call.
+// Without a heap, text is written to a stream directly instead.
+struct help_buffer {
+    char *data;
+    size_t len;
+    size_t capacity;
+    _Bool failed; // Set if the buffer could not grow; the text is truncated.
+    struct optparse_ctx *ctx; // The context whose allocator provides
+                              // temporary memory while rendering.
+#if OPTPARSE_NO_HEAP
+    FILE *stream; // The stream text is written to; NULL to only measure it.
+    size_t skip;  // The number of characters to leave out at the start.
+#endif
+};
+
+// Appends n characters to a help buffer.
+static void hb_write(struct help_buffer *hb, const char *str, size_t n)
+{
+#if OPTPARSE_NO_HEAP
+    if (hb->stream && hb->len + n > hb->skip) {
+        size_t skip = hb->len < hb->skip ? hb->skip - hb->len : 0;
+        fwrite(str + skip, 1, n - skip, hb->stream);
+    }
+#else
+    if (hb->len + n > hb->capacity) {
+        size_t capacity = hb->capacity ? hb->capacity : 4096;
+        while (capacity < hb->len + n) {
+            capacity *= 2;
+        }
+        char *data = hb->failed ? NULL : realloc(hb->data, capacity);
+        if (data == NULL) {
+            hb->failed = true;
+            return;
+        }
+        hb->data = data;
+        hb->capacity = capacity;
+    }
+    memcpy(hb->data + hb->len, str, n);
+#endif
+    hb->len += n;
+}
+
+// Appends a string to a help buffer.
+static void hb_puts(struct help_buffer *hb, const char *str)
+{
+    hb_write(hb, str, strlen(str));
+}
+
+// Appends n spaces to a help buffer.
+static void hb_pad(struct help_buffer *hb, int n)
+{
+    static const char spaces[] = "                                ";
+    while (n > 0) {
+        int chunk = n < (int) sizeof spaces - 1 ? n : (int) sizeof spaces - 1;
+        hb_write(hb, spaces, chunk);
+        n -= chunk;
+    }
+}
+
+// Prints a string using automatic word-wrapping.
+// hb: the buffer the string will be printed to
+// str: the string to be printed
+// first_line_indent: the known column at which printing starts
+// indent: the indentation width (starting from line 2)
+static void blockprint(struct help_buffer *hb, char *str, int first_line_indent,
+    int indent, int end)
+{
+#if OPTPARSE_HELP_WORD_WRAP
+    if (str == NULL || str[0] == '\0') {
+        hb_write(hb, "\n", 1);
+        return;
+    }
+
+    int first_line_printed = 0;
+    int width = end - indent;
+
+    // If there's no room left on the first line, start on the next one.
+    if (first_line_indent >= end) {
+        hb_write(hb, "\n", 1);
+        first_line_printed = 1;
+    }
+    if (width < 1) {
+        width = 1;
+    }
+
+    while (1) {
+        // Indentation
+        if (first_line_printed) {
+            hb_pad(hb, indent);
+        } else {
+            width = end - first_line_indent;
+        }
+
+        int n = 0; // Number of characters to be printed on the current line
+
+        while (n <= width) {
+            // Print early when encountering a newline character.
+            if (str[n] == '\n') {
+                hb_write(hb, str, ++n);
+                str += n;
+                goto next;
+            }
+            // Print and finish if string is shorter than width.
+            if (str[n] == '\0') {
+                hb_write(hb, str, n);
+                hb_write(hb, "\n", 1);
+                return;
+            }
+            n++;
+        } // If this loop survives, word-wrapping will happen.
+        n--;
+
+        // First make sure not to truncate the last word...
+        while (n > 0 && str[n] != ' ') {
+            n--;
+        }
+
+        // ...then make sure not to print any trailing spaces.
+        while (n > 0 && str[n - 1] == ' ') {
+            n--;
+        }
+
+        // Truncate if the string is too long.
+        if (n == 0) {
+            n = width;
+        }
+
+        hb_write(hb, str, n);
+        hb_write(hb, "\n", 1);
+        str += n;
+
+        // Remove word-separating leading space before printing the next line.
+        if (str[0] == ' ') {
+            str++;
+        }
+
+        next:
+        if (first_line_printed == 0) {
+            first_line_printed = 1;
+            width = end - indent > 0 ? end - indent : 1;
+        }
+    }
+#else
+    (void) first_line_indent;
+    (void) indent;
+    (void) end;
+    hb_puts(hb, str);
+    hb_write(hb, "\n", 1);
+#endif
+}
+
+
+#if OPTPARSE_SUBCOMMANDS
+// Returns the number of commands in a command's chain of parents, including the
+// root command and the command itself.
+static int get_cmd_depth(struct optparse_cmd *cmd)
+{
+    int depth = 0;
+    do {
+        depth++;
+        cmd = cmd->_parent;
+    } while (cmd);
+    return depth;
+}
+
+// Fills an array with the names of a command's parents, including the root
+// command, and the command itself, in the order in which they appear in the
+// command tree.
+static void build_cmd_array(struct optparse_cmd *cmd, int depth,
+    char *array[depth + 1])
+{
+    array[depth] = NULL;
+    while (depth--) {
+        array[depth] = cmd->name;
+        cmd = cmd->_parent;
+    }
+}
+#endif
+
+#if OPTPARSE_HELP_USAGE_STYLE == 1 && OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+// Returns whether an option belongs to a group.
+static int in_group(struct optparse_opt *opt, int group)
+{
+    int g;
+    for (int i = 0; (g = next_option_group(opt, &i));) {
+        if (g == group) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Prints the mutually exclusive option groups an option belongs to, with all
+// of their members, to a buffer. Groups that have already been printed are
+// skipped, and an option whose groups all have been printed is not printed.
+// printed: the bit set of the groups that have been printed, which is updated
+static void bprint_exclusive_option_group(char *buffer,
+    struct optparse_opt *opt, unsigned char *printed)
+{
+    int group;
+    for (int i = 0; (group = next_option_group(opt, &i));) {
+        if (has_group(printed, group)) {
+            continue;
+        }
+        printed[group / CHAR_BIT] |= 1 << (group % CHAR_BIT);
+
+        bprintf(buffer, " [");
+        bprint_option_usage(buffer, opt);
+
+        struct optparse_opt *member = opt;
+        while ((++member)->short_name != (char) END_OF_OPTIONS) {
+            if (in_group(member, group)) {
+                bprintf(buffer, "|");
+                bprint_option_usage(buffer, member);
+            }
+        }
+
+        bprintf(buffer, "]");
+    }
+}
+#endif
+
+// Prints a command's usage.
+static void print_usage(struct help_buffer *hb, struct optparse_cmd *cmd)
+{
+#if OPTPARSE_HELP_LETTER_CASE == 0
+    hb_puts(hb, "Usage:");
+#elif OPTPARSE_HELP_LETTER_CASE == 1
+    hb_puts(hb, "usage:");
+#elif OPTPARSE_HELP_LETTER_CASE == 2
+    hb_puts(hb, "USAGE:");
+#endif
+
+    char buffer[OPTPARSE_PRINT_BUFFER_SIZE];
+    buffer[0] = '\0';
+
+    // If a custom usage string is provided, print it and return.
+    if (cmd->usage) {
+        bprintf(buffer, " %s\n", cmd->usage);
+        goto print;
+    }
+
+    // Print command name(s).
+#if OPTPARSE_SUBCOMMANDS
+    {
+        int depth = get_cmd_depth(cmd);
+        char *cmd_array[depth + 1];
+        build_cmd_array(cmd, depth, cmd_array);
+        for (int i = 0; cmd_array[i]; i++) {
+            bprintf(buffer, " %s", cmd_array[i]);
+        }
+    }
+#else
+    bprintf(buffer, " %s", cmd->name);
+#endif
+
+    // Print command's options.
+    if (cmd->options) {
+#if OPTPARSE_HELP_USAGE_STYLE == 1
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+        // The groups that have been printed, as a bit set like the one the
+        // parser keeps (see init_groups()).
+        size_t printed_size = (size_t) get_max_group(cmd) / CHAR_BIT + 1;
+        unsigned char printed_buffer[GROUPS_STACK_MAX / CHAR_BIT + 1];
+        unsigned char *printed = printed_size > sizeof printed_buffer
+            ? ctx_malloc(hb->ctx, printed_size) : printed_buffer;
+        if (printed == NULL) {
+            // Print the options without their groups, and don't cache the
+            // incomplete help screen.
+            hb->failed = true;
+            bprintf(buffer, " [" OPTPARSE_HELP_USAGE_OPTIONS_STRING "]");
+            goto operands;
+        }
+        memset(printed, 0, printed_size);
+#endif
+
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+#if OPTPARSE_HIDDEN_OPTIONS
+            // Don't print options marked as "hidden".
+            if (opt->hidden) {
+                opt++;
+                continue;
+            }
+#endif
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+            int i = 0;
+            if (next_option_group(opt, &i)) {
+                bprint_exclusive_option_group(buffer, opt, printed);
+            } else
+#endif
+            {
+                bprintf(buffer, " [");
+                bprint_option_usage(buffer, opt);
+                bprintf(buffer, "]");
+            }
+            opt++;
+        }
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+        if (printed != printed_buffer) {
+            ctx_free(hb->ctx, printed);
+        }
+#endif
+#else
+        bprintf(buffer, " [" OPTPARSE_HELP_USAGE_OPTIONS_STRING "]");
+#endif
+    }
+
+#if OPTPARSE_HELP_USAGE_STYLE == 1 && OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    operands:
+#endif
+    // Print command's operands.
+    if (cmd->operands) {
+        bprintf(buffer, " %s", cmd->operands);
+    }
+
+    print:
+    blockprint(hb, buffer, 7, 7, OPTPARSE_HELP_MAX_LINE_WIDTH);
+}
+
+// Prints a set of options (names, arguments, descriptions).
+// Returns the calculated divider width.
+static void print_options(struct help_buffer *hb, struct optparse_opt options[])
+{
+    struct optparse_opt *opt = options;
+    int divider_width = 0;
+
+    // Determine divider width -------------------------------------------------
+    // (see section "Print" below to know where the numbers come from)
+    while (opt->short_name != (char) END_OF_OPTIONS) {
+#if OPTPARSE_HIDDEN_OPTIONS
+        if (opt->hidden) {
+            opt++;
+            continue;
+        }
+#endif
+
+        int len = OPTPARSE_HELP_INDENTATION_WIDTH * 2;
+
+        if (opt->short_name) {
+            len += 2;
+#if OPTPARSE_LONG_OPTIONS
+            if (opt->long_name) {
+                len += 2;
+            }
+        } else if (OPTPARSE_HELP_UNIQUE_COLUMN_FOR_LONG_OPTIONS) {
+            len += 4;
+#endif
+        }
+
+#if OPTPARSE_LONG_OPTIONS
+        if (opt->long_name) {
+            len += 2 + strlen(opt->long_name);
+        }
+#endif
+
+        // Snap divider to options.
+        if (len > divider_width && len <= OPTPARSE_HELP_MAX_DIVIDER_WIDTH) {
+            divider_width = len;
+        }
+
+        if (opt->arg_name) {
+#if OPTPARSE_ATTACHED_OPTION_ARGUMENTS
+            if (opt->arg_name[0] == '[') {
+#if OPTPARSE_LONG_OPTIONS
+                if (opt->long_name) {
+                    len += 1 + strlen(opt->arg_name);
+                } else
+#endif
+                len += strlen(opt->arg_name);
+            } else
+#endif
+            len += 1 + strlen(opt->arg_name);
+        }
+
+        // Snap divider to arguments.
+        if (len > divider_width) {
+            divider_width = len;
+        }
+        opt++;
+    }
+
+    if (divider_width > OPTPARSE_HELP_MAX_DIVIDER_WIDTH) {
+        divider_width = OPTPARSE_HELP_MAX_DIVIDER_WIDTH;
+    }
+
+    // Print options -----------------------------------------------------------
+    opt = options;
+    while (opt->short_name != (char) END_OF_OPTIONS) {
+#if OPTPARSE_HIDDEN_OPTIONS
+        if (opt->hidden) {
+            opt++;
+            continue;
+        }
+#endif
+
+        size_t start = hb->len;
+
+        hb_pad(hb, OPTPARSE_HELP_INDENTATION_WIDTH);
+
+        // Print option's short name.
+        if (opt->short_name) {
+            hb_write(hb, "-", 1);
+            hb_write(hb, &opt->short_name, 1);
+#if OPTPARSE_LONG_OPTIONS
+            if (opt->long_name) {
+                hb_write(hb, ", ", 2);
+            }
+        } else if (OPTPARSE_HELP_UNIQUE_COLUMN_FOR_LONG_OPTIONS) {
+            hb_pad(hb, 4);
+#endif
+        }
+
+#if OPTPARSE_LONG_OPTIONS
+        // Print option's long name.
+        if (opt->long_name) {
+            hb_write(hb, "--", 2);
+            hb_puts(hb, opt->long_name);
+        }
+#endif
+
+        // Print option's arguments.
+        if (opt->arg_name) {
+#if OPTPARSE_ATTACHED_OPTION_ARGUMENTS
+            if (opt->arg_name[0] == '[') {
+#if OPTPARSE_LONG_OPTIONS
+                if (opt->long_name) {
+                    hb_write(hb, "[=", 2);
+                    hb_puts(hb, opt->arg_name + 1);
+                } else
+#endif
+                hb_puts(hb, opt->arg_name);
+            } else
+#endif
+            {
+                hb_write(hb, " ", 1);
+                hb_puts(hb, opt->arg_name);
+            }
+        }
+
+        hb_pad(hb, OPTPARSE_HELP_INDENTATION_WIDTH);
+        int len = (int) (hb->len - start);
+
+        // Adjust spacing before printing option's description.
+        if (len < divider_width) {
+            hb_pad(hb, divider_width - len);
+            len = divider_width;
+        }
+
+        // Print option's description.
+        if (opt->description) {
+            if (len > divider_width) {
+#if OPTPARSE_HELP_FLOATING_DESCRIPTIONS
+                blockprint(hb, opt->description, len, divider_width,
+                    OPTPARSE_HELP_MAX_LINE_WIDTH);
+#else
+                hb_write(hb, "\n", 1);
+                hb_pad(hb, divider_width);
+                blockprint(hb, opt->description, divider_width,
+                    divider_width, OPTPARSE_HELP_MAX_LINE_WIDTH);
+#endif
+            } else {
+                blockprint(hb, opt->description, divider_width,
+                    divider_width, OPTPARSE_HELP_MAX_LINE_WIDTH);
+            }
+        } else {
+            hb_write(hb, "\n", 1);
+        }
+
+        opt++;
+    }
+}
+
+#if OPTPARSE_SUBCOMMANDS
+// Prints a list of a command's subcommands.
+static void print_subcommands(struct help_buffer *hb,
+    struct optparse_cmd subcommands[])
+{
+    struct optparse_cmd *subcmd;
+    int divider_width = 0;
+
+    // Determine subcommand list's divider width.
+    subcmd = subcommands;
+    while (subcmd->name != END_OF_SUBCOMMANDS) {
+        int len = strlen(subcmd->name);
+        if (subcmd->operands) {
+            len += strlen(subcmd->operands) + 1;
+        }
+        if (len > divider_width) {
+            divider_width = len;
+        }
+        subcmd++;
+    }
+    divider_width += 2 * OPTPARSE_HELP_INDENTATION_WIDTH;
+    if (divider_width > OPTPARSE_HELP_MAX_DIVIDER_WIDTH) {
+        divider_width = OPTPARSE_HELP_MAX_DIVIDER_WIDTH;
+    }
+
+    // Print list of subcommands.
+    subcmd = subcommands;
+    while (subcmd->name != END_OF_SUBCOMMANDS) {
+        size_t start = hb->len;
+        hb_pad(hb, OPTPARSE_HELP_INDENTATION_WIDTH);
+        hb_puts(hb, subcmd->name);
+        if (subcmd->operands) {
+            hb_write(hb, " ", 1);
+            hb_puts(hb, subcmd->operands);
+        }
+        hb_pad(hb, OPTPARSE_HELP_INDENTATION_WIDTH);
+        int n = (int) (hb->len - start);
+        if (n < divider_width) {
+            hb_pad(hb, divider_width - n);
+        }
+
+        if (subcmd->about) {
+            if (n > divider_width) {
+#if OPTPARSE_HELP_FLOATING_DESCRIPTIONS
+                blockprint(hb, subcmd->about, n, divider_width,
+                    OPTPARSE_HELP_MAX_LINE_WIDTH);
+#else
+                hb_write(hb, "\n", 1);
+                hb_pad(hb, divider_width);
+                blockprint(hb, subcmd->about, divider_width, divider_width,
+                    OPTPARSE_HELP_MAX_LINE_WIDTH);
 #endif
-        if (opt->arg_data_type) { // Option-argument is a single value.
-            int ret;
-            ret = strtox(arg, &conv_arg, opt->arg_data_type);
-            if (ret == 1) {
-                optparse_error("Argument not valid: \"%s\"\n", arg);
-            } else if (ret == -1) {
-                optparse_error("Value out of range: \"%s\"\n", arg);
+            } else {
+                blockprint(hb, subcmd->about, divider_width, divider_width,
+                    OPTPARSE_HELP_MAX_LINE_WIDTH);
+            }
+        } else {
+            hb_write(hb, "\n", 1);
+        }
+
+        subcmd++;
+    }
+}
+#endif
+
+// Renders a command's complete help information: about, usage, description,
+// options, subcommands.
+// about_len, usage_len: receive the lengths of the "about" and usage parts
+static void render_help(struct help_buffer *hb, struct optparse_cmd *cmd,
+    size_t *about_len, size_t *usage_len)
+{
+    if (cmd->about) {
+        blockprint(hb, cmd->about, 0, 0, OPTPARSE_HELP_MAX_LINE_WIDTH);
+    }
+    *about_len = hb->len;
+
+    // Print command's usage.
+    print_usage(hb, cmd);
+    *usage_len = hb->len - *about_len;
+
+    // Print command's description.
+    if (cmd->description) {
+        hb_write(hb, "\n", 1);
+        blockprint(hb, cmd->description, 0, 0, OPTPARSE_HELP_MAX_LINE_WIDTH);
+    }
+
+    // Print command's options.
+    if (cmd->options) {
+#if OPTPARSE_HELP_LETTER_CASE == 0
+        hb_puts(hb, "\nOptions:\n");
+#elif OPTPARSE_HELP_LETTER_CASE == 1
+        hb_puts(hb, "\noptions:\n");
+#elif OPTPARSE_HELP_LETTER_CASE == 2
+        hb_puts(hb, "\nOPTIONS:\n");
+#endif
+        print_options(hb, cmd->options);
+    }
+
+#if OPTPARSE_SUBCOMMANDS
+    // Print list of subcommands.
+    if (cmd->subcommands) {
+#if OPTPARSE_HELP_LETTER_CASE == 0
+        hb_puts(hb, "\nCommands:\n");
+#elif OPTPARSE_HELP_LETTER_CASE == 1
+        hb_puts(hb, "\ncommands:\n");
+#elif OPTPARSE_HELP_LETTER_CASE == 2
+        hb_puts(hb, "\nCOMMANDS:\n");
+#endif
+        print_subcommands(hb, cmd->subcommands);
+    }
+#endif
+}
+
+#if OPTPARSE_NO_HEAP
+// Prints a command's complete help information while rendering it. The "about"
+// part, which is measured first, is left out when printing to stderr, i.e.
+// along with errors.
+static void print_help(struct optparse_ctx *ctx, FILE *stream,
+    struct optparse_cmd *cmd)
+{
+    struct help_buffer hb = { 0 };
+    if (stream == stderr && cmd->about) {
+        blockprint(&hb, cmd->about, 0, 0, OPTPARSE_HELP_MAX_LINE_WIDTH);
+    }
+    hb = (struct help_buffer) { .ctx = ctx, .stream = stream, .skip = hb.len };
+
+    size_t about_len;
+    size_t usage_len;
+    render_help(&hb, cmd, &about_len, &usage_len);
+}
+#else
+// Returns a command's cached help screen, or NULL if it has not been rendered
+// yet.
+static struct rendered_help *get_cached_help(struct optparse_index *index)
+{
+#if defined __GNUC__
+    return __atomic_load_n(&index->help, __ATOMIC_ACQUIRE);
+#elif OPTPARSE_BATCH_THREADS
+    pthread_mutex_lock(&help_mutex);
+    struct rendered_help *help = index->help;
+    pthread_mutex_unlock(&help_mutex);
+    return help;
+#else
+    return index->help;
+#endif
+}
+
+// Caches a command's rendered help screen, unless another thread has cached
+// one first, in which case help is freed. Contexts may print help screens on
+// several threads at once, even without OPTPARSE_BATCH_THREADS.
+// Return value: the cached help screen
+static struct rendered_help *cache_help(struct optparse_index *index,
+    struct rendered_help *help)
+{
+#if defined __GNUC__
+    struct rendered_help *cached = NULL;
+    if (!__atomic_compare_exchange_n(&index->help, &cached, help, false,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(help);
+        return cached;
+    }
+    return help;
+#else
+#if OPTPARSE_BATCH_THREADS
+    pthread_mutex_lock(&help_mutex);
+#endif
+    if (index->help) {
+        free(help);
+        help = index->help;
+    } else {
+        index->help = help;
+    }
+#if OPTPARSE_BATCH_THREADS
+    pthread_mutex_unlock(&help_mutex);
+#endif
+    return help;
+#endif
+}
+
+// Prints a command's complete help information with a single write. The help
+// screen is rendered once and then kept in the command's index, if it has one.
+// The "about" part is left out when printing to stderr, i.e. along with errors.
+static void print_help(struct optparse_ctx *ctx, FILE *stream,
+    struct optparse_cmd *cmd)
+{
+    struct optparse_index *index = cmd->_index;
+    struct rendered_help *help = index ? get_cached_help(index) : NULL;
+    struct help_buffer hb = { .ctx = ctx };
+    size_t about_len = 0;
+
+    if (help == NULL) {
+        size_t usage_len;
+        render_help(&hb, cmd, &about_len, &usage_len);
+        if (index && !hb.failed) {
+            help = malloc(sizeof *help + hb.len);
+        }
+        if (help) {
+            help->len = hb.len;
+            help->about_len = about_len;
+            memcpy(help->data, hb.data, hb.len);
+            free(hb.data);
+            hb.data = NULL;
+            help = cache_help(index, help);
+        }
+    }
+    if (help) {
+        hb.len = help->len;
+        about_len = help->about_len;
+    }
+
+    const char *data = help ? help->data : hb.data;
+    size_t skip = stream == stderr ? about_len : 0;
+    if (hb.len > skip) {
+        fwrite(data + skip, 1, hb.len - skip, stream);
+    }
+    free(hb.data);
+}
+#endif
+#endif
+
+#if OPTPARSE_HELP_PRERENDERED && OPTPARSE_SUBCOMMANDS
+// Returns the number of commands in a command tree.
+static size_t count_cmds(struct optparse_cmd *cmd)
+{
+    size_t n = 1;
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            n += count_cmds(subcmd);
+            subcmd++;
+        }
+    }
+    return n;
+}
+#endif
+
+#if (!OPTPARSE_HELP_PRERENDERED || !OPTPARSE_GENERATED_PARSER) \
+    && !OPTPARSE_NO_HEAP
+// Prints a character as it would appear inside a C string or character literal.
+static void print_c_char(FILE *stream, char c)
+{
+    unsigned char u = c;
+    if (u == '\n') {
+        fputs("\\n", stream);
+    } else if (u == '\\' || u == '"' || u == '\'' || u == '?') {
+        fprintf(stream, "\\%c", u); // '?': no trigraphs
+    } else if (u < ' ' || u > '~') {
+        fprintf(stream, "\\%03o", u);
+    } else {
+        fputc(u, stream);
+    }
+}
+#endif
+
+#if OPTPARSE_HELP_PRERENDERED
+// Returns a command's position in the command tree, counting depth-first, which
+// is its index in optparse_prerendered_help[].
+static size_t get_cmd_id(struct optparse_cmd *cmd)
+{
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->_parent) {
+        size_t id = get_cmd_id(cmd->_parent) + 1;
+        for (struct optparse_cmd *sibling = cmd->_parent->subcommands;
+                sibling != cmd; sibling++) {
+            id += count_cmds(sibling);
+        }
+        return id;
+    }
+#else
+    (void) cmd;
+#endif
+    return 0;
+}
+
+// Prints a command's pre-rendered help information.
+// The "about" part is left out when printing to stderr, i.e. along with errors.
+static void print_help(struct optparse_ctx *ctx, FILE *stream,
+    struct optparse_cmd *cmd)
+{
+    (void) ctx; // Nothing is rendered.
+    const struct optparse_prerendered_help *help =
+        &optparse_prerendered_help[get_cmd_id(cmd)];
+    fputs(help->text + (stream == stderr ? help->about_len : 0), stream);
+}
+#elif !OPTPARSE_NO_HEAP
+// Prints a string as C string literals, one per line of text.
+static void print_c_string(FILE *stream, const char *str, size_t len)
+{
+    fputs("    \"", stream);
+    for (size_t i = 0; i < len; i++) {
+        print_c_char(stream, str[i]);
+        if (str[i] == '\n' && i + 1 < len) {
+            fputs("\"\n    \"", stream);
+        }
+    }
+    fputs("\"", stream);
+}
+
+// Prints the help screens of a command tree as C source code, depth-first.
+// id: the number of help screens printed so far
+// lens: receives each help screen's "about" and usage lengths
+// Return value: 0 on success, -1 if a help screen could not be rendered
+static int print_prerendered_help(FILE *stream, struct optparse_cmd *cmd,
+    size_t *id, size_t lens[][2])
+{
+    struct help_buffer hb = { .ctx = &default_ctx };
+    render_help(&hb, cmd, &lens[*id][0], &lens[*id][1]);
+    if (hb.failed) {
+        free(hb.data);
+        return -1;
+    }
+    fprintf(stream, "\nstatic const char help_%zu[] =\n", *id);
+    print_c_string(stream, hb.data, hb.len);
+    fputs(";\n", stream);
+    free(hb.data);
+    (*id)++;
+
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            if (print_prerendered_help(stream, subcmd, id, lens)) {
+                return -1;
+            }
+            subcmd++;
+        }
+    }
+#endif
+
+    return 0;
+}
+#endif
+
+#if !OPTPARSE_GENERATED_PARSER && !OPTPARSE_NO_HEAP
+// The C types and enumerators of the data types, for generated code.
+static const char *const data_type_names[][2] = {
+    [DATA_TYPE_STR] = { "char *", "DATA_TYPE_STR" },
+    [DATA_TYPE_CHAR] = { "char", "DATA_TYPE_CHAR" },
+    [DATA_TYPE_SCHAR] = { "signed char", "DATA_TYPE_SCHAR" },
+    [DATA_TYPE_UCHAR] = { "unsigned char", "DATA_TYPE_UCHAR" },
+    [DATA_TYPE_SHRT] = { "short", "DATA_TYPE_SHRT" },
+    [DATA_TYPE_USHRT] = { "unsigned short", "DATA_TYPE_USHRT" },
+    [DATA_TYPE_INT] = { "int", "DATA_TYPE_INT" },
+    [DATA_TYPE_UINT] = { "unsigned int", "DATA_TYPE_UINT" },
+    [DATA_TYPE_LONG] = { "long", "DATA_TYPE_LONG" },
+    [DATA_TYPE_ULONG] = { "unsigned long", "DATA_TYPE_ULONG" },
+    [DATA_TYPE_LLONG] = { "long long", "DATA_TYPE_LLONG" },
+    [DATA_TYPE_ULLONG] = { "unsigned long long", "DATA_TYPE_ULLONG" },
+#if OPTPARSE_FLOATING_POINT_SUPPORT
+    [DATA_TYPE_FLT] = { "float", "DATA_TYPE_FLT" },
+    [DATA_TYPE_DBL] = { "double", "DATA_TYPE_DBL" },
+    [DATA_TYPE_LDBL] = { "long double", "DATA_TYPE_LDBL" },
+#endif
+    [DATA_TYPE_BOOL] = { "_Bool", "DATA_TYPE_BOOL" },
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+    [DATA_TYPE_INT8] = { "int8_t", "DATA_TYPE_INT8" },
+    [DATA_TYPE_UINT8] = { "uint8_t", "DATA_TYPE_UINT8" },
+    [DATA_TYPE_INT16] = { "int16_t", "DATA_TYPE_INT16" },
+    [DATA_TYPE_UINT16] = { "uint16_t", "DATA_TYPE_UINT16" },
+    [DATA_TYPE_INT32] = { "int32_t", "DATA_TYPE_INT32" },
+    [DATA_TYPE_UINT32] = { "uint32_t", "DATA_TYPE_UINT32" },
+    [DATA_TYPE_INT64] = { "int64_t", "DATA_TYPE_INT64" },
+    [DATA_TYPE_UINT64] = { "uint64_t", "DATA_TYPE_UINT64" },
+#endif
+};
+
+#if OPTPARSE_LONG_OPTIONS
+// The generated code's hash functions, which must compute the same values as
+// perfect_hash_name() and perfect_hash_slot().
+static const char perfect_hash_code[] =
+    "\n"
+    "struct long_slot {\n"
+    "    const char *name;\n"
+    "    int id;\n"
+    "};\n"
+    "\n"
+    "static unsigned long perfect_hash_name(const char *str, unsigned long h)\n"
+    "{\n"
+    "    while (*str != '\\0') {\n"
+    "        h = ((h ^ (unsigned char) *str++) * 16777619UL) & 0xffffffffUL;\n"
+    "    }\n"
+    "    return h;\n"
+    "}\n"
+    "\n"
+    "static unsigned long perfect_hash_slot(unsigned long h,\n"
+    "    unsigned long seed)\n"
+    "{\n"
+    "    h = (h ^ (seed * 0x9e3779b9UL)) & 0xffffffffUL;\n"
+    "    h ^= h >> 16;\n"
+    "    h = (h * 0x45d9f3bUL) & 0xffffffffUL;\n"
+    "    return h ^ (h >> 16);\n"
+    "}\n";
+
+// Returns the 32-bit FNV-1a hash value of a string, starting from the basis h.
+static unsigned long perfect_hash_name(const char *str, unsigned long h)
+{
+    while (*str != '\0') {
+        h = ((h ^ (unsigned char) *str++) * 16777619UL) & 0xffffffffUL;
+    }
+    return h;
+}
+
+// Mixes a name's hash value with its bucket's seed into the name's slot
+// number, before it's masked.
+static unsigned long perfect_hash_slot(unsigned long h, unsigned long seed)
+{
+    h = (h ^ (seed * 0x9e3779b9UL)) & 0xffffffffUL;
+    h ^= h >> 16;
+    h = (h * 0x45d9f3bUL) & 0xffffffffUL;
+    return h ^ (h >> 16);
+}
+
+// Builds a perfect hash table of distinct long names by hashing and
+// displacing: a name whose hash value is h is stored in the slot
+// perfect_hash_slot(h, seeds[h & (n_buckets - 1)]) & (n_slots - 1), and the
+// buckets' seeds are searched for, largest bucket first, so that no two names
+// share a slot.
+// names: the names; n: their number, at least 1
+// n_slots, n_buckets: powers of two; n_slots must be at least n
+// basis: receives the hash basis
+// seeds: receives the n_buckets seeds
+// slots: receives, for each of the n_slots slots, the index in names[] of the
+// slot's name, or -1 if the slot is empty
+// Return value: 0 on success, -1 on allocation failure or if no table was found
+static int build_perfect_hash(const char **names, size_t n, size_t n_slots,
+    size_t n_buckets, unsigned long *basis, unsigned short *seeds, int *slots)
+{
+    size_t mask = n_slots - 1;
+    unsigned long *hashes = malloc(n * sizeof *hashes);
+    size_t *next = malloc(n * sizeof *next);     // The next name in a bucket.
+    size_t *first = malloc(n_buckets * sizeof *first);
+    size_t *sizes = malloc(n_buckets * sizeof *sizes);
+    int ret = -1;
+    if (hashes == NULL || next == NULL || first == NULL || sizes == NULL) {
+        goto out;
+    }
+
+    // Names whose full hash values collide cannot be separated by any seed,
+    // so other bases are tried.
+    for (unsigned long attempt = 0; attempt < 64 && ret; attempt++) {
+        *basis = 2166136261UL + attempt;
+        size_t max_size = 0;
+        for (size_t b = 0; b < n_buckets; b++) {
+            first[b] = n;
+            sizes[b] = 0;
+        }
+        for (size_t i = 0; i < n; i++) {
+            hashes[i] = perfect_hash_name(names[i], *basis);
+            size_t b = hashes[i] & (n_buckets - 1);
+            next[i] = first[b];
+            first[b] = i;
+            if (++sizes[b] > max_size) {
+                max_size = sizes[b];
+            }
+        }
+        for (size_t i = 0; i <= mask; i++) {
+            slots[i] = -1;
+        }
+
+        ret = 0;
+        for (size_t size = max_size; size > 0 && ret == 0; size--) {
+            for (size_t b = 0; b < n_buckets && ret == 0; b++) {
+                if (sizes[b] != size) {
+                    continue;
+                }
+
+                unsigned long seed;
+                for (seed = 0; seed <= USHRT_MAX; seed++) {
+                    // Place the bucket's names, and take them back out if one
+                    // of them lands in an occupied slot.
+                    size_t i;
+                    for (i = first[b]; i != n; i = next[i]) {
+                        size_t slot = perfect_hash_slot(hashes[i], seed) & mask;
+                        if (slots[slot] != -1) {
+                            break;
+                        }
+                        slots[slot] = (int) i;
+                    }
+                    if (i == n) {
+                        break;
+                    }
+                    for (size_t j = first[b]; j != i; j = next[j]) {
+                        slots[perfect_hash_slot(hashes[j], seed) & mask] = -1;
+                    }
+                }
+                if (seed > USHRT_MAX) {
+                    ret = -1;
+                }
+                seeds[b] = (unsigned short) seed;
+            }
+        }
+    }
+
+out:
+    free(hashes);
+    free(next);
+    free(first);
+    free(sizes);
+    return ret;
+}
+
+// Returns whether any option of a command tree has a long name.
+static _Bool has_long_names(struct optparse_cmd *cmd)
+{
+    if (cmd->options) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            if (opt->long_name) {
+                return true;
+            }
+            opt++;
+        }
+    }
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            if (has_long_names(subcmd)) {
+                return true;
+            }
+            subcmd++;
+        }
+    }
+#endif
+    return false;
+}
+
+// Prints a generated function that returns the index of a command's option
+// that has the specified long name, or -1 if there is none.
+// Return value: 0 on success, -1 if no perfect hash table could be built
+static int print_generated_find_long(FILE *stream, struct optparse_cmd *cmd,
+    size_t id)
+{
+    fprintf(stream, "\nstatic int find_long_%zu(const char *long_name)\n{\n",
+        id);
+
+    // Collect the distinct long names; the first option of a name wins.
+    size_t n = 0;
+    struct optparse_opt *opt;
+    if (cmd->options) {
+        for (opt = cmd->options; opt->short_name != (char) END_OF_OPTIONS;
+                opt++) {
+            n += opt->long_name != NULL;
+        }
+    }
+    if (n == 0) {
+        fputs("    (void) long_name;\n    return -1;\n}\n", stream);
+        return 0;
+    }
+
+    // The table is at least half full, with about two names per bucket.
+    size_t n_slots = 1;
+    while (n_slots < n) {
+        n_slots *= 2;
+    }
+    size_t n_buckets = n_slots > 1 ? n_slots / 2 : 1;
+    const char **names = malloc(n * sizeof *names);
+    int *ids = malloc(n * sizeof *ids);
+    unsigned short *seeds = malloc(n_buckets * sizeof *seeds);
+    int *slots = malloc(n_slots * sizeof *slots);
+    unsigned long basis;
+    int ret = -1;
+    if (names == NULL || ids == NULL || seeds == NULL || slots == NULL) {
+        goto out;
+    }
+    n = 0;
+    for (opt = cmd->options; opt->short_name != (char) END_OF_OPTIONS; opt++) {
+        if (opt->long_name && find_long_option(cmd, opt->long_name) == opt) {
+            names[n] = opt->long_name;
+            ids[n] = (int) (opt - cmd->options);
+            n++;
+        }
+    }
+    if (build_perfect_hash(names, n, n_slots, n_buckets, &basis, seeds,
+            slots)) {
+        goto out;
+    }
+
+    fprintf(stream, "    static const unsigned short seeds[%zu] = {",
+        n_buckets);
+    for (size_t b = 0; b < n_buckets; b++) {
+        fprintf(stream, "%s%u", b == 0 ? "\n        "
+            : b % 8 ? ", " : ",\n        ", seeds[b]);
+    }
+    fprintf(stream, "\n    };\n"
+        "    static const struct long_slot slots[%zu] = {\n", n_slots);
+    for (size_t i = 0; i < n_slots; i++) {
+        if (slots[i] == -1) {
+            fputs("        { NULL, -1 },\n", stream);
+        } else {
+            fputs("        { \"", stream);
+            for (const char *c = names[slots[i]]; *c != '\0'; c++) {
+                print_c_char(stream, *c);
+            }
+            fprintf(stream, "\", %d },\n", ids[slots[i]]);
+        }
+    }
+    fprintf(stream, "    };\n"
+        "    unsigned long h = perfect_hash_name(long_name, %luUL);\n"
+        "    const struct long_slot *slot =\n"
+        "        &slots[perfect_hash_slot(h, seeds[h & %zu]) & %zu];\n"
+        "    return slot->name && strcmp(slot->name, long_name) == 0 ? "
+        "slot->id : -1;\n}\n", basis, n_buckets - 1, n_slots - 1);
+    ret = 0;
+
+out:
+    free(names);
+    free(ids);
+    free(seeds);
+    free(slots);
+    return ret;
+}
+#endif
+
+// Prints the case of a generated function that executes an option like
+// execute_option() does outside of batch mode, with the option's types fixed.
+// Options with lists, or with array function types, are left out and so
+// handed back to execute_option().
+static void print_generated_execution(FILE *stream, struct optparse_opt *opt,
+    int id)
+{
+#if OPTPARSE_LIST_SUPPORT
+    if (opt->arg_delim) {
+        return;
+    }
+#endif
+    enum optparse_function_type function_type = opt->function_type;
+    if (function_type == FUNCTION_TYPE_AUTO) {
+        function_type = opt->arg_name ? FUNCTION_TYPE_TARG : FUNCTION_TYPE_VOID;
+    }
+    if (opt->function && function_type != FUNCTION_TYPE_TARG
+            && function_type != FUNCTION_TYPE_OARG
+            && function_type != FUNCTION_TYPE_VOID) {
+        return;
+    }
+
+    const char *type = data_type_names[opt->arg_data_type][0];
+    const char *type_name = data_type_names[opt->arg_data_type][1];
+    _Bool is_str = opt->arg_data_type == DATA_TYPE_STR;
+    _Bool optional = opt->arg_name && opt->arg_name[0] == '[';
+    const char *indent = optional ? "                " : "            ";
+
+    fprintf(stream, "        case %d: {\n", id);
+    if (!is_str && (opt->arg_name || (opt->function
+            && function_type == FUNCTION_TYPE_TARG))) {
+        fprintf(stream, "            %s value = 0;\n", type);
+    }
+    if (opt->arg_name && !is_str) {
+        if (optional) {
+            fputs("            if (arg) {\n", stream);
+        }
+        fprintf(stream, "%sint ret = strtox(arg, &value, %s);\n"
+            "%sif (ret) {\n%s    return ret;\n%s}\n", indent, type_name,
+            indent, indent, indent);
+        if (optional) {
+            fputs("            }\n", stream);
+        }
+    }
+
+    if (opt->flag) {
+        static const char *const flag_code[] = {
+            [FLAG_TYPE_SET_TRUE] = "*opt->flag = 1;",
+            [FLAG_TYPE_SET_FALSE] = "*opt->flag = 0;",
+            [FLAG_TYPE_INCREMENT] = "*opt->flag += 1;",
+            [FLAG_TYPE_DECREMENT] = "*opt->flag -= 1;",
+        };
+        fprintf(stream, "            %s\n", flag_code[opt->flag_type]);
+    }
+
+    if (opt->arg_name && opt->arg_storage) {
+        if (optional) {
+            fputs("            if (arg) {\n", stream);
+        }
+        if (is_str) {
+            fprintf(stream, "%s*(char **) opt->arg_storage = arg;\n", indent);
+        } else {
+            fprintf(stream, "%s*(%s *) opt->arg_storage = value;\n", indent,
+                type);
+        }
+        if (optional) {
+            fputs("            }\n", stream);
+        }
+    }
+
+    if (opt->function) {
+        if (function_type == FUNCTION_TYPE_VOID) {
+            fputs("            opt->function();\n", stream);
+        } else if (function_type == FUNCTION_TYPE_OARG || is_str) {
+            fputs("            ((void (*)(char *)) opt->function)(arg);\n",
+                stream);
+        } else {
+            fprintf(stream, "            ((void (*)(%s)) opt->function)(value);"
+                "\n", type);
+        }
+    }
+    fputs("            return 0;\n        }\n", stream);
+}
+
+// Prints the generated lookup and execution functions of a command tree's
+// commands, depth-first.
+// id: the number of commands printed so far
+// Return value: 0 on success, -1 if a long option table could not be built
+static int print_generated_cmd(FILE *stream, struct optparse_cmd *cmd,
+    size_t *id)
+{
+    struct optparse_opt *opt;
+
+    fprintf(stream, "\nstatic int find_short_%zu(char short_name)\n{\n", *id);
+    fputs("    switch (short_name) {\n", stream);
+    if (cmd->options) {
+        for (opt = cmd->options; opt->short_name != (char) END_OF_OPTIONS;
+                opt++) {
+            if (opt->short_name
+                    && find_short_option(cmd, opt->short_name) == opt) {
+                fputs("        case '", stream);
+                print_c_char(stream, opt->short_name);
+                fprintf(stream, "': return %d;\n",
+                    (int) (opt - cmd->options));
             }
         }
+    }
+    fputs("    }\n    return -1;\n}\n", stream);
 
-        // Store the (type-converted) option-argument...
-        if (opt->arg_storage) {
-#if OPTPARSE_LIST_SUPPORT
-            if (opt->arg_delim) {
-                *(void **) opt->arg_storage = list_array;
-            } else
+#if OPTPARSE_LONG_OPTIONS
+    if (print_generated_find_long(stream, cmd, *id)) {
+        return -1;
+    }
 #endif
-            if (opt->arg_data_type == DATA_TYPE_STR) {
-                *(char **) opt->arg_storage = arg;
-            } else {
-                size_t n = get_data_type_size(opt->arg_data_type);
-                memcpy(opt->arg_storage, &conv_arg, n);
+
+    fprintf(stream, "\nstatic int execute_%zu(struct optparse_opt *opt, int id, "
+        "char *arg)\n{\n    (void) opt;\n    (void) arg;\n"
+        "    switch (id) {\n", *id);
+    if (cmd->options) {
+        for (opt = cmd->options; opt->short_name != (char) END_OF_OPTIONS;
+                opt++) {
+            print_generated_execution(stream, opt, (int) (opt - cmd->options));
+        }
+    }
+    fputs("    }\n    return 2;\n}\n", stream);
+    (*id)++;
+
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            if (print_generated_cmd(stream, subcmd, id)) {
+                return -1;
             }
+            subcmd++;
         }
     }
+#endif
 
-#if OPTPARSE_LIST_SUPPORT
-    // Store the storage size.
-    if (opt->arg_delim && opt->arg_storage_size) {
-        *opt->arg_storage_size = list_size;
+    return 0;
+}
+#endif
+
+#if OPTPARSE_SUBCOMMANDS
+// Parses a command chain and returns the subcommmand the chain leads to.
+// Reports an error and returns NULL if the chain is invalid.
+static struct optparse_cmd *read_cmd_chain(struct optparse_ctx *ctx,
+    struct optparse_cmd *cmd, char **argv)
+{
+    if (*argv && cmd->subcommands) {
+        struct optparse_cmd *subcmd = find_subcommand(cmd, *argv);
+        if (subcmd) {
+            return read_cmd_chain(ctx, subcmd, ++argv);
+        }
+
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_UNKNOWN_COMMAND, .index = -1, .arg = *argv,
+            .token = *argv });
+        return NULL;
+    } else {
+        return cmd;
     }
+}
 #endif
 
-    // Call option's function.
-    if (opt->function) {
-        switch (opt->function_type) {
-            case FUNCTION_TYPE_AUTO:
-                if (opt->arg_name) {
-#if OPTPARSE_LIST_SUPPORT
-                    if (opt->arg_delim) {
-                        goto type_targ_array;
-                    } else
+#ifndef NDEBUG
+// Recursively checks a command's option structure for impossible/faulty setups.
+static void check_cmd(struct optparse_cmd *cmd)
+{
+    // The command's name is required.
+    assert(cmd->name != NULL);
+
+    if (cmd->options) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            // At least one of those is required.
+#if OPTPARSE_LONG_OPTIONS
+            assert(opt->short_name || opt->long_name);
+#else
+            assert(opt->short_name);
 #endif
-                    goto type_targ;
-                } else {
-                    goto type_void;
-                }
-            case FUNCTION_TYPE_OARG:
+
+            // Option names must be unique.
+            assert(!opt->short_name
+                || find_short_option(cmd, opt->short_name) == opt);
+#if OPTPARSE_LONG_OPTIONS
+            assert(!opt->long_name
+                || find_long_option(cmd, opt->long_name) == opt);
+#endif
+
+            // Make sure option-argument is named properly.
+            assert((opt->arg_name && opt->arg_name[0] == '['
+                && opt->arg_name[strlen(opt->arg_name) - 1] == ']')
+                || (opt->arg_name && opt->arg_name[0] != '[')
+                || !opt->arg_name);
+
 #if OPTPARSE_LIST_SUPPORT
-                ((void (*)(char *)) opt->function)(oarg);
-#else
-                ((void (*)(char *)) opt->function)(arg);
+            // .arg_storage_size requires .arg_delim and .arg_storage.
+            assert((opt->arg_storage_size && opt->arg_delim && opt->arg_storage)
+                || !opt->arg_storage_size);
+
+            // Splitting and then calling like a non-array type-converted value
+            // existed would produce random values.
+            assert((opt->arg_delim && opt->function_type != FUNCTION_TYPE_TARG)
+                || !opt->arg_delim);
+
+            // If the option-argument is not split, no array exists and array
+            // functions must not be called.
+            assert((!opt->arg_delim && opt->function_type
+                != FUNCTION_TYPE_TARG_ARRAY && opt->function_type
+                != FUNCTION_TYPE_OARG_ARRAY) || opt->arg_delim);
+
+            // Lists whose items are streamed to the option's function are not
+            // stored.
+            assert((opt->function_type != FUNCTION_TYPE_TARG_EACH
+                && opt->function_type != FUNCTION_TYPE_TARG_CHUNK)
+                || (opt->arg_delim && !opt->arg_storage));
+
+#if OPTPARSE_LIST_FILES
+            // Only lists can be read from files.
+            assert(!opt->arg_from_file || opt->arg_delim);
 #endif
-                break;
-            case FUNCTION_TYPE_TARG:
-                type_targ:
-                switch (opt->arg_data_type) {
-                    case DATA_TYPE_STR:
-                        ((void (*)(char *)) opt->function)(arg);
-                        break;
-                    case DATA_TYPE_CHAR:
-                        ((void (*)(char)) opt->function)(conv_arg.t_char);
-                        break;
-                    case DATA_TYPE_SCHAR:
-                        ((void (*)(signed char)) opt->function)(
-                            conv_arg.t_schar);
-                        break;
-                    case DATA_TYPE_UCHAR:
-                        ((void (*)(unsigned char)) opt->function)(
-                            conv_arg.t_uchar);
-                        break;
-                    case DATA_TYPE_SHRT:
-                        ((void (*)(short)) opt->function)(conv_arg.t_shrt);
-                        break;
-                    case DATA_TYPE_USHRT:
-                        ((void (*)(unsigned short)) opt->function)(
-                            conv_arg.t_ushrt);
-                        break;
-                    case DATA_TYPE_INT:
-                        ((void (*)(int)) opt->function)(conv_arg.t_int);
-                        break;
-                    case DATA_TYPE_UINT:
-                        ((void (*)(unsigned int)) opt->function)(
-                            conv_arg.t_uint);
-                        break;
-                    case DATA_TYPE_LONG:
-                        ((void (*)(long)) opt->function)(conv_arg.t_long);
-                        break;
-                    case DATA_TYPE_ULONG:
-                        ((void (*)(unsigned long)) opt->function)(
-                            conv_arg.t_ulong);
-                        break;
-                    case DATA_TYPE_LLONG:
-                        ((void (*)(long long)) opt->function)(conv_arg.t_llong);
-                        break;
-                    case DATA_TYPE_ULLONG:
-                        ((void (*)(unsigned long long)) opt->function)(
-                            conv_arg.t_ullong);
-                        break;
-#if OPTPARSE_FLOATING_POINT_SUPPORT
-                    case DATA_TYPE_FLT:
-                        ((void (*)(float)) opt->function)(conv_arg.t_flt);
-                        break;
-                    case DATA_TYPE_DBL:
-                        ((void (*)(double)) opt->function)(conv_arg.t_dbl);
-                        break;
-                    case DATA_TYPE_LDBL:
-                        ((void (*)(long double)) opt->function)(
-                            conv_arg.t_ldbl);
-                        break;
 #endif
-                    case DATA_TYPE_BOOL:
-                        ((void (*)(_Bool)) opt->function)(conv_arg.t_bool);
-                        break;
-#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
-                    case DATA_TYPE_INT8:
-                        ((void (*)(int8_t)) opt->function)(conv_arg.t_int8);
-                        break;
-                    case DATA_TYPE_UINT8:
-                        ((void (*)(uint8_t)) opt->function)(conv_arg.t_uint8);
-                        break;
-                    case DATA_TYPE_INT16:
-                        ((void (*)(int16_t)) opt->function)(conv_arg.t_int16);
-                        break;
-                    case DATA_TYPE_UINT16:
-                        ((void (*)(uint16_t)) opt->function)(conv_arg.t_uint16);
-                        break;
-                    case DATA_TYPE_INT32:
-                        ((void (*)(int32_t)) opt->function)(conv_arg.t_int32);
-                        break;
-                    case DATA_TYPE_UINT32:
-                        ((void (*)(uint32_t)) opt->function)(conv_arg.t_uint32);
-                        break;
-                    case DATA_TYPE_INT64:
-                        ((void (*)(int64_t)) opt->function)(conv_arg.t_int64);
-                        break;
-                    case DATA_TYPE_UINT64:
-                        ((void (*)(uint64_t)) opt->function)(conv_arg.t_uint64);
-                        break;
+
+#if OPTPARSE_ENV_VARIABLES
+            // Environment variable names can't contain "=".
+            assert(opt->env_name == NULL || (opt->env_name[0] != '\0'
+                && strchr(opt->env_name, '=') == NULL));
 #endif
-                }
-                break;
-#if OPTPARSE_LIST_SUPPORT
-            case FUNCTION_TYPE_OARG_ARRAY:
-                {
-                    char **array = NULL;
-                    size_t size = strtoarr(oarg, (void *) &array,
-                        opt->arg_delim, DATA_TYPE_STR);
-                    ((void (*)(size_t, char **)) opt->function)(size, array);
-                    if (array) {
-                        free(array);
-                    }
-                }
-                break;
-            case FUNCTION_TYPE_TARG_ARRAY:
-                type_targ_array:
-                switch (opt->arg_data_type) {
-                    case DATA_TYPE_STR:
-                        ((void (*)(size_t, char **)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_CHAR:
-                        ((void (*)(size_t, char *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_SCHAR:
-                        ((void (*)(size_t, signed char *)) opt->function)(
-                            list_size, list_array);
-                        break;
-                    case DATA_TYPE_UCHAR:
-                        ((void (*)(size_t, unsigned char *)) opt->function)(
-                            list_size, list_array);
-                        break;
-                    case DATA_TYPE_SHRT:
-                        ((void (*)(size_t, short *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_USHRT:
-                        ((void (*)(size_t, unsigned short *)) opt->function)(
-                            list_size, list_array);
-                        break;
-                    case DATA_TYPE_INT:
-                        ((void (*)(size_t, int *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_UINT:
-                        ((void (*)(size_t, unsigned int *)) opt->function)(
-                            list_size, list_array);
-                        break;
-                    case DATA_TYPE_LONG:
-                        ((void (*)(size_t, long *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_ULONG:
-                        ((void (*)(size_t, unsigned long *)) opt->function)(
-                            list_size, list_array);
-                        break;
-                    case DATA_TYPE_LLONG:
-                        ((void (*)(size_t, long long *)) opt->function)(
-                            list_size, list_array);
-                        break;
-                    case DATA_TYPE_ULLONG:
-                        ((void (*)(size_t, unsigned long long *)) opt->function)
-                            (list_size, list_array);
-                        break;
-#if OPTPARSE_FLOATING_POINT_SUPPORT
-                    case DATA_TYPE_FLT:
-                        ((void (*)(size_t, float *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_DBL:
-                        ((void (*)(size_t, double *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_LDBL:
-                        ((void (*)(size_t, long double *)) opt->function)(
-                            list_size, list_array);
-                        break;
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+            // Group values must not be negative.
+            assert(opt->group >= 0);
+            for (int *group = opt->groups; group && *group; group++) {
+                assert(*group > 0);
+            }
 #endif
-                    case DATA_TYPE_BOOL:
-                        ((void (*)(size_t, _Bool *)) opt->function)(list_size,
-                            list_array);
-                        break;
-#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
-                    case DATA_TYPE_INT8:
-                        ((void (*)(size_t, int8_t *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_UINT8:
-                        ((void (*)(size_t, uint8_t *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_INT16:
-                        ((void (*)(size_t, int16_t *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_UINT16:
-                        ((void (*)(size_t, uint16_t *)) opt->function)(
-                            list_size, list_array);
-                        break;
-                    case DATA_TYPE_INT32:
-                        ((void (*)(size_t, int32_t *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_UINT32:
-                        ((void (*)(size_t, uint32_t *)) opt->function)(
-                            list_size, list_array);
-                        break;
-                    case DATA_TYPE_INT64:
-                        ((void (*)(size_t, int64_t *)) opt->function)(list_size,
-                            list_array);
-                        break;
-                    case DATA_TYPE_UINT64:
-                        ((void (*)(size_t, uint64_t *)) opt->function)(
-                            list_size, list_array);
-                        break;
+
+            opt++;
+        }
+    }
+
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            // Subcommand names must be unique.
+            assert(find_subcommand(cmd, subcmd->name) == subcmd);
+
+            check_cmd(subcmd);
+            subcmd++;
+        }
+    }
 #endif
-                }
-                break;
+}
 #endif
-            case FUNCTION_TYPE_VOID:
-                type_void:
-                ((void (*)(void)) opt->function)();
-                break;
+
+// Builds the lookup tables of a command tree and numbers its options and
+// commands, depth-first.
+// n_opts: the number of options numbered so far
+// n_cmds: the number of commands numbered so far
+// Return value: 0 on success, -1 if a lookup table could not be built
+static int compile(struct optparse_cmd *cmd, int *n_opts, size_t *n_cmds)
+{
+    int ret = 0;
+
+    if (cmd->_index == NULL) {
+        build_index(cmd, true);
+    }
+    if (cmd->_index) {
+        cmd->_index->first_opt_id = *n_opts;
+#if OPTPARSE_GENERATED_PARSER
+        cmd->_index->generated = &optparse_generated_parser[*n_cmds];
+#endif
+    } else {
+        ret = -1;
+    }
+    *n_opts += count_own_options(cmd);
+    (*n_cmds)++;
+
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            subcmd->_parent = cmd;
+            if (compile(subcmd, n_opts, n_cmds)) {
+                ret = -1;
+            }
+            subcmd++;
+        }
+    }
+#endif
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    // Subcommands are compiled first, so their values can be reused.
+    if (cmd->_index) {
+        cmd->_index->max_group = find_max_group(cmd);
+    }
+#endif
+
+    return ret;
+}
+
+#if OPTPARSE_COMPILED_TREES
+// Writes a 32-bit unsigned integer to index i of an unaligned array.
+static void write_u32(unsigned char *array, size_t i, uint32_t value)
+{
+    memcpy(array + i * sizeof value, &value, sizeof value);
+}
+
+// Returns an option's traits, as stored in a compiled tree: its flag type (bits
+// 0-1), its function type (bits 2-4), and whether it has an option-argument
+// (bit 5), an optional one (bit 6) or a list (bit 7).
+static unsigned char get_traits(struct optparse_opt *opt)
+{
+    unsigned traits = opt->flag_type | opt->function_type << 2;
+    if (opt->arg_name) {
+        traits |= 1 << 5;
+        if (opt->arg_name[0] == '[') {
+            traits |= 1 << 6;
+        }
+#if OPTPARSE_LIST_SUPPORT
+        if (opt->arg_delim) {
+            traits |= 1 << 7;
+        }
+#endif
+    }
+    return (unsigned char) traits;
+}
+
+// Counts the commands, options, long option table slots and long name bytes of
+// a command tree, adding them to sizes[TREE_N_CMDS], sizes[TREE_N_OPTS],
+// sizes[TREE_SLOTS] and sizes[TREE_POOL].
+static void measure_tree(struct optparse_cmd *cmd, size_t *sizes)
+{
+    size_t n_long_opts = 0;
+    sizes[TREE_N_CMDS]++;
+    if (cmd->options) {
+        struct optparse_opt *opt = cmd->options;
+        while (opt->short_name != (char) END_OF_OPTIONS) {
+            sizes[TREE_N_OPTS]++;
+#if OPTPARSE_LONG_OPTIONS
+            if (opt->long_name) {
+                sizes[TREE_POOL] += strlen(opt->long_name);
+                n_long_opts++;
+            }
+#endif
+            opt++;
+        }
+    }
+    sizes[TREE_SLOTS] += get_table_mask(n_long_opts) + 1;
+
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            measure_tree(subcmd, sizes);
+            subcmd++;
         }
     }
+#endif
+}
 
-#if OPTPARSE_LIST_SUPPORT
-    // List-related clean-up.
-    if (opt->arg_delim && !opt->arg_storage) {
-        free(list_array);
+// Computes the header of a compiled tree from the sizes measure_tree() counted.
+// Return value: 0 on success, -1 if the compiled tree would be too large
+static int get_tree_header(const size_t *sizes, uint32_t *header)
+{
+    size_t offsets[TREE_HEADER_LEN] = {
+        [TREE_MAGIC] = COMPILED_TREE_MAGIC,
+        [TREE_N_CMDS] = sizes[TREE_N_CMDS],
+        [TREE_N_OPTS] = sizes[TREE_N_OPTS],
+    };
+    offsets[TREE_CMDS] = TREE_HEADER_LEN * sizeof (uint32_t);
+    offsets[TREE_HASHES] = offsets[TREE_CMDS]
+        + sizes[TREE_N_CMDS] * TREE_CMD_LEN * sizeof (uint32_t);
+    offsets[TREE_NAME_OFFSETS] = offsets[TREE_HASHES]
+        + sizes[TREE_N_OPTS] * sizeof (uint32_t);
+    offsets[TREE_NAME_LENS] = offsets[TREE_NAME_OFFSETS]
+        + sizes[TREE_N_OPTS] * sizeof (uint32_t);
+    offsets[TREE_SLOTS] = offsets[TREE_NAME_LENS]
+        + sizes[TREE_N_OPTS] * sizeof (uint32_t);
+    offsets[TREE_SHORT_NAMES] = offsets[TREE_SLOTS]
+        + sizes[TREE_SLOTS] * sizeof (uint32_t);
+    offsets[TREE_TYPES] = offsets[TREE_SHORT_NAMES] + sizes[TREE_N_OPTS];
+    offsets[TREE_TRAITS] = offsets[TREE_TYPES] + sizes[TREE_N_OPTS];
+    offsets[TREE_POOL] = offsets[TREE_TRAITS] + sizes[TREE_N_OPTS];
+    offsets[TREE_SIZE] = offsets[TREE_POOL] + sizes[TREE_POOL];
+    if (offsets[TREE_SIZE] > UINT32_MAX) {
+        return -1;
     }
-    if (oarg != arg) {
-        free(oarg);
+    for (size_t i = 0; i < TREE_HEADER_LEN; i++) {
+        header[i] = (uint32_t) offsets[i];
     }
-#endif
+    return 0;
 }
 
-#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
-// Prints a mutually exclusive option's name ("-o, --option") to a buffer.
-static void bprint_option_name(char *buffer, struct optparse_opt *opt)
+// Writes the records of a command tree to a compiled tree, whose header must be
+// complete, and whose other bytes must be zero.
+// ids: the numbers of the commands (ids[TREE_N_CMDS]), options
+// (ids[TREE_N_OPTS]) and long option table slots (ids[TREE_SLOTS]) written so
+// far, and the pool's length (ids[TREE_POOL])
+static void write_compiled_cmd(unsigned char *tree, struct optparse_cmd *cmd,
+    size_t *ids)
 {
-    if (opt->short_name) {
-        bprintf(buffer, "-%c", opt->short_name);
+    unsigned char *record = tree + read_u32(tree, TREE_CMDS)
+        + ids[TREE_N_CMDS]++ * TREE_CMD_LEN * sizeof (uint32_t);
+    size_t first_opt = ids[TREE_N_OPTS];
+    size_t n_opts = (size_t) count_own_options(cmd);
+    size_t n_long_opts = 0;
 #if OPTPARSE_LONG_OPTIONS
-        if (opt->long_name) {
-            bprintf(buffer, ", ");
+    for (size_t i = 0; i < n_opts; i++) {
+        n_long_opts += cmd->options[i].long_name != NULL;
+    }
+#endif
+    size_t mask = get_table_mask(n_long_opts);
+#if OPTPARSE_LONG_OPTIONS
+    unsigned char *slots = tree + read_u32(tree, TREE_SLOTS)
+        + ids[TREE_SLOTS] * sizeof (uint32_t);
+#endif
+    write_u32(record, TREE_CMD_FIRST_OPT, (uint32_t) first_opt);
+    write_u32(record, TREE_CMD_N_OPTS, (uint32_t) n_opts);
+    write_u32(record, TREE_CMD_SLOTS, (uint32_t) ids[TREE_SLOTS]);
+    write_u32(record, TREE_CMD_SLOTS_MASK, (uint32_t) mask);
+    ids[TREE_N_OPTS] += n_opts;
+    ids[TREE_SLOTS] += mask + 1;
+
+    for (size_t id = 0; id < n_opts; id++) {
+        struct optparse_opt *opt = &cmd->options[id];
+        size_t o = first_opt + id;
+        tree[read_u32(tree, TREE_SHORT_NAMES) + o] = (unsigned char)
+            opt->short_name;
+        tree[read_u32(tree, TREE_TYPES) + o] = (unsigned char)
+            opt->arg_data_type;
+        tree[read_u32(tree, TREE_TRAITS) + o] = get_traits(opt);
+#if OPTPARSE_LONG_OPTIONS
+        if (opt->long_name == NULL) {
+            continue;
+        }
+        size_t len;
+        uint32_t hash = (uint32_t) hash_name(opt->long_name, '\0', &len);
+        char *pool = (char *) tree + read_u32(tree, TREE_POOL);
+        memcpy(pool + ids[TREE_POOL], opt->long_name, len);
+        write_u32(tree + read_u32(tree, TREE_HASHES), o, hash);
+        write_u32(tree + read_u32(tree, TREE_NAME_OFFSETS), o,
+            (uint32_t) ids[TREE_POOL]);
+        write_u32(tree + read_u32(tree, TREE_NAME_LENS), o, (uint32_t) len);
+        ids[TREE_POOL] += len;
+
+        // If the name is already taken, the first option wins, as it would in
+        // a linear search.
+        size_t i = hash & mask;
+        uint32_t slot;
+        while ((slot = read_u32(slots, i)) != 0
+                && strcmp(cmd->options[slot - 1].long_name, opt->long_name)) {
+            i = (i + 1) & mask;
+        }
+        if (slot == 0) {
+            write_u32(slots, i, (uint32_t) id + 1);
         }
 #endif
     }
 
-#if OPTPARSE_LONG_OPTIONS
-    if (opt->long_name) {
-        bprintf(buffer, "--%s", opt->long_name);
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            write_compiled_cmd(tree, subcmd, ids);
+            subcmd++;
+        }
     }
 #endif
 }
 
-// Checks an option for mutual exclusivity violations and quits on error.
-static void check_mutual_exclusivity(struct optparse_opt *opt)
+// Checks whether the command records of a compiled tree match a command tree.
+// ids: the numbers of the commands, options and long option table slots checked
+// so far, indexed as in write_compiled_cmd()
+// Return value: 0 if they match, -1 otherwise
+static int check_compiled_cmd(const unsigned char *tree,
+    struct optparse_cmd *cmd, size_t *ids)
 {
-    static struct optparse_opt *exclusive_opts[OPTPARSE_MUTUALLY_EXCLUSIVE_GROUPS_MAX];
-
-    if (opt->group > 0 && opt->group
-            < OPTPARSE_MUTUALLY_EXCLUSIVE_GROUPS_MAX) {
-        if (exclusive_opts[opt->group]) {
-            char buffer1[OPTPARSE_PRINT_BUFFER_SIZE];
-            buffer1[0] = '\0';
-            char buffer2[OPTPARSE_PRINT_BUFFER_SIZE];
-            buffer2[0] = '\0';
-            bprint_option_name(buffer1, exclusive_opts[opt->group]);
-            bprint_option_name(buffer2, opt);
-            optparse_error("Options %s and %s are mutually exclusive.\n",
-                buffer1, buffer2);
-        } else {
-            exclusive_opts[opt->group] = opt;
-        }
+    if (ids[TREE_N_CMDS] >= read_u32(tree, TREE_N_CMDS)) {
+        return -1;
     }
-}
-#endif
-
-#if OPTPARSE_LONG_OPTIONS
-// Identifies and executes a single known long option.
-static void execute_long_option(char *long_name, struct optparse_opt options[])
-{
-    if (options == NULL) {
-        goto unknown_option;
+    const unsigned char *record = tree + read_u32(tree, TREE_CMDS)
+        + ids[TREE_N_CMDS]++ * TREE_CMD_LEN * sizeof (uint32_t);
+    size_t n_opts = (size_t) count_own_options(cmd);
+    size_t n_slots = (size_t) read_u32(record, TREE_CMD_SLOTS_MASK) + 1;
+    if (read_u32(record, TREE_CMD_FIRST_OPT) != ids[TREE_N_OPTS]
+            || read_u32(record, TREE_CMD_N_OPTS) != n_opts
+            || read_u32(record, TREE_CMD_SLOTS) != ids[TREE_SLOTS]
+            || n_slots & (n_slots - 1)) {
+        return -1;
     }
+    ids[TREE_N_OPTS] += n_opts;
+    ids[TREE_SLOTS] += n_slots;
 
-#if OPTPARSE_ATTACHED_OPTION_ARGUMENTS
-    char *arg = strchr(long_name, '=');
-    if (arg) {
-        *arg++ = '\0';
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            if (check_compiled_cmd(tree, subcmd, ids)) {
+                return -1;
+            }
+            subcmd++;
+        }
     }
-#else
-    char *arg = NULL;
 #endif
+    return 0;
+}
 
-    struct optparse_opt *opt = options;
-    while (opt->short_name != (char) END_OF_OPTIONS) {
-        if (opt->long_name && strcmp(long_name, opt->long_name) == 0) {
-#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
-            check_mutual_exclusivity(opt);
-#endif
-            if (arg) {
-                if (!opt->arg_name) {
-                    optparse_error("Unwanted option-argument: \"%s\"\n", arg);
-                }
-            } else if (opt->arg_name && opt->arg_name[0] != '[') {
-                arg = args[++args_index];
-                if (arg == NULL) {
-                    optparse_error("Option \"--%s\" requires an argument.\n",
-                        long_name);
-                }
+// Checks the long option tables and long names of a compiled tree whose header
+// has been checked: every slot must hold 0 or the number of one of its
+// command's options + 1, every table must have an empty slot to end lookups,
+// and every long name must lie within the pool.
+// Return value: 0 if they are valid, -1 otherwise
+static int check_compiled_tables(const unsigned char *tree)
+{
+    const unsigned char *slots = tree + read_u32(tree, TREE_SLOTS);
+    for (size_t c = 0; c < read_u32(tree, TREE_N_CMDS); c++) {
+        const unsigned char *record = tree + read_u32(tree, TREE_CMDS)
+            + c * TREE_CMD_LEN * sizeof (uint32_t);
+        uint32_t n_opts = read_u32(record, TREE_CMD_N_OPTS);
+        size_t first_slot = read_u32(record, TREE_CMD_SLOTS);
+        size_t n_slots = (size_t) read_u32(record, TREE_CMD_SLOTS_MASK) + 1;
+        _Bool has_empty_slot = false;
+        for (size_t i = first_slot; i < first_slot + n_slots; i++) {
+            uint32_t slot = read_u32(slots, i);
+            if (slot > n_opts) {
+                return -1;
             }
-
-            execute_option(opt, arg);
-            return;
+            has_empty_slot |= slot == 0;
+        }
+        if (!has_empty_slot) {
+            return -1;
         }
-
-        opt++;
     }
 
-    unknown_option:
-    optparse_error("Unknown option: \"--%s\"\n", long_name);
+    size_t pool_len = read_u32(tree, TREE_SIZE) - read_u32(tree, TREE_POOL);
+    for (size_t o = 0; o < read_u32(tree, TREE_N_OPTS); o++) {
+        size_t offset = read_u32(tree + read_u32(tree, TREE_NAME_OFFSETS), o);
+        size_t len = read_u32(tree + read_u32(tree, TREE_NAME_LENS), o);
+        if (offset > pool_len || len > pool_len - offset) {
+            return -1;
+        }
+    }
+    return 0;
 }
-#endif
 
-// Identifies and executes a group of known short options.
-// option_group must not be NULL.
-static void execute_short_option(char *option_group,
-    struct optparse_opt options[])
+// Makes a command tree look up its options in a compiled tree, whose command
+// records must match it.
+// n_cmds: the number of commands loaded so far
+static void load_compiled_cmd(const unsigned char *tree,
+    struct optparse_cmd *cmd, size_t *n_cmds)
 {
-    char *c = option_group + 1;
+    const unsigned char *record = tree + read_u32(tree, TREE_CMDS)
+        + (*n_cmds)++ * TREE_CMD_LEN * sizeof (uint32_t);
+    size_t first_opt = read_u32(record, TREE_CMD_FIRST_OPT);
 
-    if (options == NULL) {
-        goto unknown_option;
-    }
-
-    while (*c != '\0') {
-        char *arg = c + 1;
-        if (*arg == '\0') {
-            arg = NULL;
-        }
-
-        struct optparse_opt *opt = options;
-        while (opt->short_name != (char) END_OF_OPTIONS) {
-            if (*c == opt->short_name) {
-#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
-                check_mutual_exclusivity(opt);
+#ifndef NDEBUG
+    // The compiled tree must have been compiled from this command tree.
+    size_t n_opts = read_u32(record, TREE_CMD_N_OPTS);
+    for (size_t id = 0; id < n_opts; id++) {
+        struct optparse_opt *opt = &cmd->options[id];
+        size_t o = first_opt + id;
+        assert(tree[read_u32(tree, TREE_SHORT_NAMES) + o]
+            == (unsigned char) opt->short_name);
+        assert(tree[read_u32(tree, TREE_TYPES) + o] == opt->arg_data_type);
+        assert(tree[read_u32(tree, TREE_TRAITS) + o] == get_traits(opt));
+#if OPTPARSE_LONG_OPTIONS
+        size_t len = opt->long_name ? strlen(opt->long_name) : 0;
+        assert(read_u32(tree + read_u32(tree, TREE_NAME_LENS), o) == len);
+        assert(memcmp(tree + read_u32(tree, TREE_POOL)
+            + read_u32(tree + read_u32(tree, TREE_NAME_OFFSETS), o),
+            opt->long_name ? opt->long_name : "", len) == 0);
 #endif
-                if (arg) {
-#if OPTPARSE_ATTACHED_OPTION_ARGUMENTS
-                    if (!opt->arg_name) {
-                        arg = NULL;
-                    }
-#else
-                    if (opt->arg_name) {
-                        optparse_error("Option -%c (in sequence \"%s\")"
-                            " requires an argument.\n", *c, option_group);
-                    } else {
-                        arg = NULL;
-                    }
+    }
 #endif
-                } else if (opt->arg_name && opt->arg_name[0] != '[') {
-                    arg = args[++args_index];
-                    if (arg == NULL) {
-                        optparse_error(
-                            "Option -%c requires an argument.\n", *c);
-                    }
-                }
-
-                execute_option(opt, arg);
-                if (arg) {
-                    return;
-                } else {
-                    goto next;
-                }
-            }
 
-            opt++;
-        }
+    if (cmd->_index == NULL) {
+        build_index(cmd, false);
+    }
+    if (cmd->_index) {
+        cmd->_index->compiled = (struct compiled_cmd) {
+            .slots = tree + read_u32(tree, TREE_SLOTS)
+                + read_u32(record, TREE_CMD_SLOTS) * sizeof (uint32_t),
+            .hashes = tree + read_u32(tree, TREE_HASHES)
+                + first_opt * sizeof (uint32_t),
+            .name_offsets = tree + read_u32(tree, TREE_NAME_OFFSETS)
+                + first_opt * sizeof (uint32_t),
+            .name_lens = tree + read_u32(tree, TREE_NAME_LENS)
+                + first_opt * sizeof (uint32_t),
+            .pool = (const char *) tree + read_u32(tree, TREE_POOL),
+            .slots_mask = read_u32(record, TREE_CMD_SLOTS_MASK),
+        };
+    }
 
-        unknown_option:
-        if (option_group[1] != '\0' && option_group[2] != '\0') {
-            optparse_error("Unknown option: \"-%c\" (in sequence \"%s\")\n", *c,
-                option_group);
-        } else {
-            optparse_error("Unknown option: \"%s\"\n", option_group);
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            load_compiled_cmd(tree, subcmd, n_cmds);
+            subcmd++;
         }
-
-        next:
-        c++;
     }
+#endif
 }
+#endif
 
-// Parses a command's command line options.
-// After parsing, only operands remain in argv.
-static void parse(int *argc, char ***argv, struct optparse_cmd *cmd)
+// Resets a context's state, but keeps its settings.
+static void reset_ctx(struct optparse_ctx *ctx, struct optparse_cmd *cmd)
 {
-    args = *argv;
-    args_index = 1;
-    *argc = 1; // To keep argv[0].
-#if OPTPARSE_SUBCOMMANDS
-    active_cmd = cmd;
-#endif
+    *ctx = (struct optparse_ctx) {
+        .main_cmd = cmd,
+        .active_cmd = cmd,
+        .help_stream = stdout,
+        .collect_errors = ctx->collect_errors,
+        .errors = ctx->errors,
+        .errors_max = ctx->errors_max,
+        .values = ctx->values,
+        .allocator = ctx->allocator,
+        .track_allocations = ctx->track_allocations,
+        .allocations = ctx->allocations,
+        .n_allocations = ctx->n_allocations,
+        .allocations_capacity = ctx->allocations_capacity,
+    };
+}
 
-    int ignore_options = 0;
-    while (args[args_index] != NULL) {
-        if (!ignore_options && args[args_index][0] == '-') { // Option
-            if (args[args_index][1] == '-') {
-                if (args[args_index][2] == '\0') { // Stand-alone option "--"
-                    ignore_options = 1;
-#if OPTPARSE_LONG_OPTIONS
-                } else { // Long option
-                    execute_long_option(args[args_index] + 2, cmd->options);
+// Parses an argument vector. Resets the context's state, but keeps its
+// settings.
+static int run(struct optparse_ctx *ctx, struct optparse_cmd *cmd, int *argc,
+    char ***argv)
+{
+    reset_ctx(ctx, cmd);
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    // The groups used in this parsing run.
+    unsigned char groups_seen[GROUPS_STACK_MAX / CHAR_BIT + 1];
+    struct optparse_opt *group_opts[GROUPS_STACK_MAX + 1];
+    if (init_groups(ctx, cmd, groups_seen, group_opts)) {
+        return ctx->stopped ? -1 : ctx->n_errors;
+    }
 #endif
-                }
-            } else { // Short option
-                execute_short_option(args[args_index], cmd->options);
-            }
-        } else { // Operand or subcommand
-#if OPTPARSE_SUBCOMMANDS
-            if (cmd->subcommands) {
-                struct optparse_cmd *subcmd = cmd->subcommands;
-                while (subcmd->name != END_OF_SUBCOMMANDS) {
-                    if (strcmp(args[args_index], subcmd->name) == 0) {
-                        // Remove previous arguments, including the subcommand,
-                        // from argv (args will be set in the next iteration).
-                        do {
-                            (*argv)[(*argc)++] = args[++args_index];
-                        } while (args[args_index]);
-                        (*argv)[*argc] = NULL;
-
-                        // Continue parsing with the subcommand.
-                        parse(argc, argv, subcmd);
-
-                        return;
-                    }
-                    subcmd++;
-                }
 
-                optparse_error("Unknown command: \"%s\"\n", args[args_index]);
-            } else
+    struct optparse_ctx *prev_ctx = current_ctx;
+    current_ctx = ctx;
+    parse(ctx, argc, argv, cmd);
+    current_ctx = prev_ctx;
+
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    release_groups(ctx, group_opts);
 #endif
-                // Treat argument as an operand, adding it to the new argv.
-                (*argv)[(*argc)++] = args[args_index];
-        }
 
-        if (args[args_index] != NULL) { // Can be NULL due to optparse_shift().
-            args_index++;
-        }
-    }
+    return ctx->stopped ? -1 : ctx->n_errors;
+}
 
-    (*argv)[*argc] = NULL;
+// A share of the jobs passed to optparse_parse_batch().
+struct batch_slice {
+    struct optparse_cmd *cmd;
+    struct optparse_job *jobs;
+    size_t n_jobs;
+};
 
-    // Run command's function on remaining operands.
-    if (cmd->function) {
-        args_index = 0;
-        cmd->function(*argc, *argv);
+// Parses a share of batch jobs. Can be used as a thread's start routine.
+static void *run_batch_slice(void *arg)
+{
+    struct batch_slice *slice = arg;
+
+    for (size_t i = 0; i < slice->n_jobs; i++) {
+        struct optparse_job *job = &slice->jobs[i];
+        assert(job->values != NULL || count_own_options(slice->cmd) == 0);
+        job->error = (struct optparse_error) { 0 };
+        struct optparse_ctx ctx = {
+            .collect_errors = true,
+            .errors = &job->error,
+            .errors_max = 1,
+            .values = job->values,
+        };
+        job->status = run(&ctx, slice->cmd, &job->argc, &job->argv);
+        job->cmd = ctx.active_cmd;
     }
 
+    return NULL;
 }
 
-/// Private "help screen" functions --------------------------------------------
+/// Public functions -----------------------------------------------------------
 
-// Prints a string using automatic word-wrapping.
-// stream: the stream the string will be printed to
-// str: the string to be printed
-// first_line_indent: the known column at which printing starts
-// indent: the indentation width (starting from line 2)
-static void blockprint(FILE *stream, char *str, int first_line_indent,
-    int indent, int end)
+// Parses command line options as described in the provided command structure.
+void optparse_parse(struct optparse_cmd *cmd, int *argc, char ***argv)
 {
-#if OPTPARSE_HELP_WORD_WRAP
-    if (str == NULL || str[0] == '\0') {
-        fputc('\n', stream);
-        return;
+    optparse_parse_ctx(&default_ctx, cmd, argc, argv);
+}
+
+// Same as optparse_parse(), but uses the context *ctx.
+int optparse_parse_ctx(struct optparse_ctx *ctx, struct optparse_cmd *cmd,
+    int *argc, char ***argv)
+{
+    if (cmd == NULL) {
+        return 0;
     }
 
-    int first_line_printed = 0;
-    int width = end - indent;
+    if (cmd->_compiled == 0) {
+        optparse_compile(cmd);
+    }
 
-    while (1) {
-        // Indentation
-        if (first_line_printed) {
-            fprintf(stream, "%*s", indent, "");
-        } else {
-            width = end - first_line_indent;
-        }
+#ifndef NDEBUG
+    check_cmd(cmd);
+#endif
 
-        int n = 0; // Number of characters to be printed on the current line
+    return run(ctx, cmd, argc, argv);
+}
 
-        while (n <= width) {
-            // Print early when encountering a newline character.
-            if (str[n] == '\n') {
-                fprintf(stream, "%.*s", ++n, str);
-                str += n;
-                goto next;
-            }
-            // Print and finish if string is shorter than width.
-            if (str[n] == '\0') {
-                fprintf(stream, "%s\n", str);
-                return;
-            }
-            n++;
-        } // If this loop survives, word-wrapping will happen.
-        n--;
+// Parses multiple argument vectors, optionally on multiple threads.
+int optparse_parse_batch(struct optparse_cmd *cmd, struct optparse_job jobs[],
+    size_t n_jobs, int n_threads)
+{
+    if (cmd == NULL || n_jobs == 0) {
+        return 0;
+    }
 
-        // First make sure not to truncate the last word...
-        while (n > 0 && str[n] != ' ') {
-            n--;
-        }
+    if (cmd->_compiled == 0) {
+        optparse_compile(cmd);
+    }
+    if (cmd->_compiled < 0) {
+        return -1; // Option ids require lookup tables.
+    }
 
-        // ...then make sure not to print any trailing spaces.
-        while (n > 0 && str[n - 1] == ' ') {
-            n--;
-        }
+#ifndef NDEBUG
+    check_cmd(cmd);
+#endif
 
-        // Truncate if the string is too long.
-        if (n == 0) {
-            n = width;
-        }
+#if OPTPARSE_BATCH_THREADS && !OPTPARSE_NO_HEAP
+    if (n_threads > 1 && (size_t) n_threads > n_jobs) {
+        n_threads = (int) n_jobs;
+    }
 
-        fprintf(stream, "%.*s\n", n, str);
-        str += n;
+    pthread_t *threads = NULL;
+    struct batch_slice *slices = NULL;
+    if (n_threads > 1) {
+        threads = malloc(n_threads * sizeof (pthread_t));
+        slices = malloc(n_threads * sizeof (struct batch_slice));
+    }
 
-        // Remove word-separating leading space before printing the next line.
-        if (str[0] == ' ') {
-            str++;
+    if (threads && slices) {
+        for (int i = 0; i < n_threads; i++) {
+            size_t first = n_jobs * i / n_threads;
+            size_t last = n_jobs * (i + 1) / n_threads;
+            slices[i] = (struct batch_slice) { cmd, jobs + first,
+                last - first };
         }
 
-        next:
-        if (first_line_printed == 0) {
-            first_line_printed = 1;
-            width = end - indent;
+        // The calling thread parses the first slice; if a thread can't be
+        // created, it parses that thread's slice as well (marked by .cmd being
+        // NULL).
+        for (int i = 1; i < n_threads; i++) {
+            if (pthread_create(&threads[i], NULL, run_batch_slice,
+                    &slices[i])) {
+                slices[i].cmd = NULL;
+            }
         }
-    }
+        run_batch_slice(&slices[0]);
+        for (int i = 1; i < n_threads; i++) {
+            if (slices[i].cmd) {
+                pthread_join(threads[i], NULL);
+            } else {
+                slices[i].cmd = cmd;
+                run_batch_slice(&slices[i]);
+            }
+        }
+    } else
 #else
-    fprintf(stream, "%s\n", str);
+    (void) n_threads;
 #endif
-}
+    {
+        run_batch_slice(&(struct batch_slice) { cmd, jobs, n_jobs });
+    }
 
+#if OPTPARSE_BATCH_THREADS && !OPTPARSE_NO_HEAP
+    free(threads);
+    free(slices);
+#endif
 
-#if OPTPARSE_SUBCOMMANDS
-// Makes a command's parent command known to all of the command's subcommands.
-// Returns the maximum depth of nested commands.
-static int initialize_subcommand_parents(struct optparse_cmd *cmd, int depth)
-{
-    if (cmd->subcommands) {
-        int max_depth = 0;
-        struct optparse_cmd *subcmd = cmd->subcommands;
-        while (subcmd->name != END_OF_SUBCOMMANDS) {
-            subcmd->_parent = cmd;
-            int ret = initialize_subcommand_parents(subcmd, depth + 1);
-            if (ret > max_depth) {
-                max_depth = ret;
-            }
-            subcmd++;
+    int n_failed = 0;
+    for (size_t i = 0; i < n_jobs; i++) {
+        if (jobs[i].status) {
+            n_failed++;
         }
-        return max_depth;
-    } else {
-        return depth;
     }
+    return n_failed;
 }
-#endif
 
-#if OPTPARSE_SUBCOMMANDS
-// Fills an array with the names of a command's parents, including the root
-// command, and the command itself, in the order in which they appear in the
-// command tree.
-static void build_cmd_array(struct optparse_cmd *cmd,
-    char *array[subcmd_depth + 1])
+// Splits a string into shell-style words, in place.
+int optparse_tokenize(char *string, char *argv[], int argv_max)
 {
-    char *temp_array[subcmd_depth + 1];
-
-    int i = 0;
-    do {
-        temp_array[i] = cmd->name;
-        cmd = cmd->_parent;
-        i++;
-    } while (cmd);
-
-    // Reverse
-    int size = i;
-    i = 0;
-    while (i < size) {
-        array[i] = temp_array[size - 1 - i];
-        i++;
+    int argc = 0;
+    _Bool malformed = false;
+    char *word;
+    while ((word = next_word(&string, &malformed)) != NULL) {
+        if (argc + 1 >= argv_max) {
+            return -1;
+        }
+        argv[argc++] = word;
+    }
+    if (malformed) {
+        return -2;
     }
-    array[i] = NULL;
+
+    argv[argc] = NULL;
+    return argc;
 }
-#endif
 
-#if OPTPARSE_HELP_USAGE_STYLE == 1 && OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
-// Prints all of a specified group's mutually exlusive options to a buffer.
-// Assumes there are at least 2 group members.
-static void bprint_exclusive_option_group(char *buffer,
-    struct optparse_opt *opt, int *printed_groups)
+// Parses a string as if it were a command line.
+int optparse_parse_string(struct optparse_ctx *ctx, struct optparse_cmd *cmd,
+    char *string, char *argv[], int argv_max)
 {
-    int group_index = opt->group;
-
-    // Don't print groups that have already been printed.
-    if (printed_groups[group_index]) {
-        return;
+    if (argv_max < 2) {
+        return -2;
     }
 
-    bprintf(buffer, " [");
-    bprint_option_usage(buffer, opt);
-
-    while ((++opt)->short_name != (char) END_OF_OPTIONS) {
-        if (opt->group == group_index) {
-            bprintf(buffer, "|");
-            bprint_option_usage(buffer, opt);
-        }
+    int argc = optparse_tokenize(string, argv + 1, argv_max - 1);
+    if (argc < 0) {
+        return -2;
     }
+    argv[0] = cmd ? cmd->name : NULL;
+    argc++;
 
-    bprintf(buffer, "]");
-    printed_groups[group_index] = 1; // Mark group as printed.
+    return optparse_parse_ctx(ctx, cmd, &argc, &argv);
 }
-#endif
 
-// Prints a command's usage.
-static void print_usage(FILE *stream, struct optparse_cmd *cmd)
+#if OPTPARSE_CONFIG_FILES && OPTPARSE_LONG_OPTIONS
+// Parses a configuration file, applying its values to the command tree's
+// options.
+int optparse_parse_config(struct optparse_cmd *cmd, const char *path)
 {
-#if OPTPARSE_SUBCOMMANDS
-    static int parents_initialized;
-    if (parents_initialized == 0) {
-        subcmd_depth = initialize_subcommand_parents(optparse_main_cmd, 1);
-        parents_initialized = 1;
+    return optparse_parse_config_ctx(&default_ctx, cmd, path);
+}
+
+// Same as optparse_parse_config(), but uses the context *ctx.
+int optparse_parse_config_ctx(struct optparse_ctx *ctx,
+    struct optparse_cmd *cmd, const char *path)
+{
+    if (cmd == NULL) {
+        return 0;
     }
-#endif
 
-#if OPTPARSE_HELP_LETTER_CASE == 0
-    fprintf(stream, "Usage:");
-#elif OPTPARSE_HELP_LETTER_CASE == 1
-    fprintf(stream, "usage:");
-#elif OPTPARSE_HELP_LETTER_CASE == 2
-    fprintf(stream, "USAGE:");
+    if (cmd->_compiled == 0) {
+        optparse_compile(cmd);
+    }
+
+#ifndef NDEBUG
+    check_cmd(cmd);
 #endif
 
-    char buffer[OPTPARSE_PRINT_BUFFER_SIZE];
-    buffer[0] = '\0';
+    reset_ctx(ctx, cmd);
 
-    // If a custom usage string is provided, print it and return.
-    if (cmd->usage) {
-        bprintf(buffer, " %s\n", cmd->usage);
-        goto print;
+    char *content = load_file(ctx, path);
+    if (content == NULL) {
+        report_error(ctx, (struct optparse_error) {
+            .type = ERROR_TYPE_FILE_ERROR, .token = (char *) path,
+            .arg = (char *) path });
+        return ctx->n_errors;
     }
 
-    // Print command name(s).
-#if OPTPARSE_SUBCOMMANDS
-    {
-        char *cmd_array[subcmd_depth + 1];
-        build_cmd_array(cmd, cmd_array);
-        for (int i = 0; cmd_array[i]; i++) {
-            bprintf(buffer, " %s", cmd_array[i]);
-        }
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    unsigned char groups_seen[GROUPS_STACK_MAX / CHAR_BIT + 1];
+    struct optparse_opt *group_opts[GROUPS_STACK_MAX + 1];
+    if (init_groups(ctx, cmd, groups_seen, group_opts)) {
+        return ctx->stopped ? -1 : ctx->n_errors;
     }
-#else
-    bprintf(buffer, " %s", optparse_main_cmd->name);
 #endif
 
-    // Print command's options.
-    if (cmd->options) {
-#if OPTPARSE_HELP_USAGE_STYLE == 1
+    struct optparse_ctx *prev_ctx = current_ctx;
+    current_ctx = ctx;
+    ctx->config_path = (char *) path;
+    parse_config(ctx, content);
+    ctx->config_path = NULL;
+    current_ctx = prev_ctx;
+
 #if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
-        int printed_groups[OPTPARSE_MUTUALLY_EXCLUSIVE_GROUPS_MAX] = { 0 };
+    release_groups(ctx, group_opts);
 #endif
 
-        struct optparse_opt *opt = cmd->options;
-        while (opt->short_name != (char) END_OF_OPTIONS) {
-#if OPTPARSE_HIDDEN_OPTIONS
-            // Don't print options marked as "hidden".
-            if (opt->hidden) {
-                opt++;
-                continue;
-            }
+    return ctx->stopped ? -1 : ctx->n_errors;
+}
 #endif
 
-#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
-            if (opt->group) {
-                bprint_exclusive_option_group(buffer, opt, printed_groups);
-            } else
-#endif
-            {
-                bprintf(buffer, " [");
-                bprint_option_usage(buffer, opt);
-                bprintf(buffer, "]");
-            }
-            opt++;
+// Returns the number of options in a command tree.
+size_t optparse_count_options(struct optparse_cmd *cmd)
+{
+    size_t n = count_own_options(cmd);
+
+#if OPTPARSE_SUBCOMMANDS
+    if (cmd->subcommands) {
+        struct optparse_cmd *subcmd = cmd->subcommands;
+        while (subcmd->name != END_OF_SUBCOMMANDS) {
+            n += optparse_count_options(subcmd);
+            subcmd++;
         }
-#else
-        bprintf(buffer, " [" OPTPARSE_HELP_USAGE_OPTIONS_STRING "]");
-#endif
     }
+#endif
 
-    // Print command's operands.
-    if (cmd->operands) {
-        bprintf(buffer, " %s", cmd->operands);
-    }
+    return n;
+}
 
-    print:
-    blockprint(stream, buffer, 7, 7, OPTPARSE_HELP_MAX_LINE_WIDTH);
+// Makes the context *ctx collect errors instead of quitting.
+void optparse_collect_errors(struct optparse_ctx *ctx,
+    struct optparse_error errors[], int errors_max)
+{
+    ctx->collect_errors = true;
+    ctx->errors = errors;
+    ctx->errors_max = errors ? errors_max : 0;
 }
 
-// Prints a set of options (names, arguments, descriptions).
-// Returns the calculated divider width.
-static void print_options(FILE *stream, struct optparse_opt options[])
+// Sets the allocator of the default context.
+void optparse_set_allocator(const struct optparse_allocator *allocator)
 {
-    struct optparse_opt *opt = options;
-    int divider_width = 0;
+    optparse_set_allocator_ctx(&default_ctx, allocator);
+}
 
-    // Determine divider width -------------------------------------------------
-    // (see section "Print" below to know where the numbers come from)
-    while (opt->short_name != (char) END_OF_OPTIONS) {
-#if OPTPARSE_HIDDEN_OPTIONS
-        if (opt->hidden) {
-            opt++;
-            continue;
-        }
-#endif
+// Sets the allocator of the context *ctx.
+void optparse_set_allocator_ctx(struct optparse_ctx *ctx,
+    const struct optparse_allocator *allocator)
+{
+    if (allocator) {
+        assert(allocator->alloc && allocator->realloc && allocator->free);
+        ctx->allocator = *allocator;
+    } else {
+        ctx->allocator = (struct optparse_allocator) { 0 };
+    }
+}
 
-        int len = OPTPARSE_HELP_INDENTATION_WIDTH * 2;
+// Makes the default context track its allocations.
+void optparse_track_allocations(_Bool track)
+{
+    optparse_track_allocations_ctx(&default_ctx, track);
+}
 
-        if (opt->short_name) {
-            len += 2;
-#if OPTPARSE_LONG_OPTIONS
-            if (opt->long_name) {
-                len += 2;
-            }
-        } else if (OPTPARSE_HELP_UNIQUE_COLUMN_FOR_LONG_OPTIONS) {
-            len += 4;
-#endif
-        }
+// Makes the context *ctx track its allocations.
+void optparse_track_allocations_ctx(struct optparse_ctx *ctx, _Bool track)
+{
+    ctx->track_allocations = track;
+}
 
-#if OPTPARSE_LONG_OPTIONS
-        if (opt->long_name) {
-            len += 2 + strlen(opt->long_name);
-        }
-#endif
+// Frees the default context's tracked allocations.
+void optparse_free_all(void)
+{
+    optparse_free_all_ctx(&default_ctx);
+}
 
-        // Snap divider to options.
-        if (len > divider_width && len <= OPTPARSE_HELP_MAX_DIVIDER_WIDTH) {
-            divider_width = len;
-        }
+// Frees the tracked allocations of the context *ctx.
+void optparse_free_all_ctx(struct optparse_ctx *ctx)
+{
+    while (ctx->n_allocations) {
+        raw_free(ctx, ctx->allocations[--ctx->n_allocations]);
+    }
+    raw_free(ctx, ctx->allocations);
+    ctx->allocations = NULL;
+    ctx->allocations_capacity = 0;
+}
 
-        if (opt->arg_name) {
-#if OPTPARSE_ATTACHED_OPTION_ARGUMENTS
-            if (opt->arg_name[0] == '[') {
-#if OPTPARSE_LONG_OPTIONS
-                if (opt->long_name) {
-                    len += 1 + strlen(opt->arg_name);
-                } else
-#endif
-                len += strlen(opt->arg_name);
-            } else
-#endif
-            len += 1 + strlen(opt->arg_name);
-        }
+// The alignment of memory handed out by arenas, which suits any type.
+#define ARENA_ALIGN sizeof (union { long double ld; long long ll; void *p; \
+    void (*f)(void); })
 
-        // Snap divider to arguments.
-        if (len > divider_width) {
-            divider_width = len;
-        }
-        opt++;
+// Hands out memory from an arena. Each allocation is preceded by its size, in
+// a header of ARENA_ALIGN bytes.
+static void *arena_alloc(size_t size, void *user_data)
+{
+    struct optparse_arena *arena = user_data;
+    size_t available = arena->size - arena->used;
+    if (available < ARENA_ALIGN
+            || size > (available - ARENA_ALIGN) / ARENA_ALIGN * ARENA_ALIGN) {
+        return NULL;
     }
 
-    if (divider_width > OPTPARSE_HELP_MAX_DIVIDER_WIDTH) {
-        divider_width = OPTPARSE_HELP_MAX_DIVIDER_WIDTH;
+    unsigned char *ptr = arena->buffer + arena->used + ARENA_ALIGN;
+    memcpy(ptr - sizeof size, &size, sizeof size);
+    arena->last = arena->used + ARENA_ALIGN;
+    arena->used = arena->last + (size + ARENA_ALIGN - 1) / ARENA_ALIGN
+        * ARENA_ALIGN;
+    return ptr;
+}
+
+// Resizes memory handed out by an arena. The most recent allocation grows or
+// shrinks in place; others are copied.
+static void *arena_realloc(void *ptr, size_t size, void *user_data)
+{
+    struct optparse_arena *arena = user_data;
+    if (ptr == NULL) {
+        return arena_alloc(size, user_data);
     }
 
-    // Print options -----------------------------------------------------------
-    opt = options;
-    while (opt->short_name != (char) END_OF_OPTIONS) {
-#if OPTPARSE_HIDDEN_OPTIONS
-        if (opt->hidden) {
-            opt++;
-            continue;
+    size_t old_size;
+    memcpy(&old_size, (unsigned char *) ptr - sizeof old_size, sizeof old_size);
+    if ((unsigned char *) ptr == arena->buffer + arena->last) {
+        arena->used = arena->last - ARENA_ALIGN;
+        if (arena_alloc(size, user_data) == NULL) {
+            arena->used = arena->last + (old_size + ARENA_ALIGN - 1)
+                / ARENA_ALIGN * ARENA_ALIGN;
+            return NULL;
         }
-#endif
+        return ptr;
+    }
 
-        int len = 0;
+    void *ret = arena_alloc(size, user_data);
+    if (ret) {
+        memcpy(ret, ptr, old_size < size ? old_size : size);
+    }
+    return ret;
+}
 
-        len += fprintf(stream, "%*c", OPTPARSE_HELP_INDENTATION_WIDTH, ' ');
+// Frees memory handed out by an arena, which is only reclaimed if it is the
+// most recent allocation.
+static void arena_free(void *ptr, void *user_data)
+{
+    struct optparse_arena *arena = user_data;
+    if ((unsigned char *) ptr == arena->buffer + arena->last) {
+        arena->used = arena->last - ARENA_ALIGN;
+        arena->last = 0;
+    }
+}
 
-        // Print option's short name.
-        if (opt->short_name) {
-            len += fprintf(stream, "-%c", opt->short_name);
-#if OPTPARSE_LONG_OPTIONS
-            if (opt->long_name) {
-                len += fprintf(stream, ", ");
-            }
-        } else if (OPTPARSE_HELP_UNIQUE_COLUMN_FOR_LONG_OPTIONS) {
-            len += fprintf(stream, "    ");
-#endif
-        }
+// Prepares an arena that hands out a caller-provided buffer.
+void optparse_arena_init(struct optparse_arena *arena, void *buffer,
+    size_t size)
+{
+    size_t skip = (ARENA_ALIGN - (uintptr_t) buffer % ARENA_ALIGN)
+        % ARENA_ALIGN;
+    *arena = (struct optparse_arena) {
+        .buffer = (unsigned char *) buffer + (skip < size ? skip : size),
+        .size = skip < size ? size - skip : 0,
+    };
+}
 
-#if OPTPARSE_LONG_OPTIONS
-        // Print option's long name.
-        if (opt->long_name) {
-            len += fprintf(stream, "--%s", opt->long_name);
-        }
-#endif
+// Returns callbacks that allocate from an arena.
+struct optparse_allocator optparse_arena_allocator(
+    struct optparse_arena *arena)
+{
+    return (struct optparse_allocator) {
+        .alloc = arena_alloc,
+        .realloc = arena_realloc,
+        .free = arena_free,
+        .user_data = arena,
+    };
+}
 
-        // Print option's arguments.
-        if (opt->arg_name) {
-#if OPTPARSE_ATTACHED_OPTION_ARGUMENTS
-            if (opt->arg_name[0] == '[') {
-#if OPTPARSE_LONG_OPTIONS
-                if (opt->long_name) {
-                    len += fprintf(stream, "[=%s", opt->arg_name + 1);
-                } else
-#endif
-                len += fprintf(stream, "%s", opt->arg_name);
-            } else
-#endif
-            len += fprintf(stream, " %s", opt->arg_name);
-        }
+// Releases all memory allocated from an arena.
+void optparse_arena_reset(struct optparse_arena *arena)
+{
+    arena->used = 0;
+    arena->last = 0;
+}
 
-        len += fprintf(stream, "%*c", OPTPARSE_HELP_INDENTATION_WIDTH, ' ');
+// Prints a parsing error's message.
+void optparse_fprint_error(FILE *stream, struct optparse_error *error)
+{
+    char *token = error->token;
+    char *arg = error->arg;
 
-        // Adjust spacing before printing option's description.
-        if (len < divider_width) {
-            len += fprintf(stream, "%*c", divider_width - len, ' ');
-        }
+    // Short options' tokens point to a single character inside arg.
+    _Bool is_short = arg && token && arg[0] == '-' && arg[1] != '-'
+        && token > arg && token < arg + strlen(arg);
 
-        // Print option's description.
-        if (opt->description) {
-            if (len > divider_width) {
-#if OPTPARSE_HELP_FLOATING_DESCRIPTIONS
-                blockprint(stream, opt->description, len, divider_width,
-                    OPTPARSE_HELP_MAX_LINE_WIDTH);
+#if OPTPARSE_LIST_SUPPORT
+    struct optparse_opt *opt = error->opt;
+    _Bool is_list = opt && opt->arg_delim;
 #else
-                fprintf(stream, "\n%*c", divider_width, ' ');
-                blockprint(stream, opt->description, divider_width,
-                    divider_width, OPTPARSE_HELP_MAX_LINE_WIDTH);
+    _Bool is_list = false;
 #endif
+
+    switch (error->type) {
+        case ERROR_TYPE_OUT_OF_MEMORY:
+            fprintf(stream, "Out of memory.\n");
+            break;
+        case ERROR_TYPE_UNKNOWN_OPTION:
+            if (!is_short) {
+                fprintf(stream, "Unknown option: \"--%s\"\n", token);
+            } else if (arg[2] != '\0') {
+                fprintf(stream, "Unknown option: \"-%c\" (in sequence \"%s\")"
+                    "\n", *token, arg);
             } else {
-                blockprint(stream, opt->description, divider_width,
-                    divider_width, OPTPARSE_HELP_MAX_LINE_WIDTH);
+                fprintf(stream, "Unknown option: \"%s\"\n", arg);
             }
-        } else {
-            fprintf(stream, "\n");
-        }
-
-        opt++;
-    }
-}
-
-#if OPTPARSE_SUBCOMMANDS
-// Prints a list of a command's subcommands.
-static void print_subcommands(FILE *stream, struct optparse_cmd subcommands[])
-{
-    struct optparse_cmd *subcmd;
-    int divider_width = 0;
-
-    // Determine subcommand list's divider width.
-    subcmd = subcommands;
-    while (subcmd->name != END_OF_SUBCOMMANDS) {
-        int len = strlen(subcmd->name);
-        if (subcmd->operands) {
-            len += strlen(subcmd->operands) + 1;
-        }
-        if (len > divider_width) {
-            divider_width = len;
-        }
-        subcmd++;
-    }
-    divider_width += 2 * OPTPARSE_HELP_INDENTATION_WIDTH;
-    if (divider_width > OPTPARSE_HELP_MAX_DIVIDER_WIDTH) {
-        divider_width = OPTPARSE_HELP_MAX_DIVIDER_WIDTH;
-    }
-
-    // Print list of subcommands.
-    subcmd = subcommands;
-    while (subcmd->name != END_OF_SUBCOMMANDS) {
-        char buffer[OPTPARSE_PRINT_BUFFER_SIZE];
-        buffer[0] = '\0';
-        int n = bprintf(buffer, "%*c%s%s%s%*c",
-            OPTPARSE_HELP_INDENTATION_WIDTH, ' ',
-            subcmd->name,
-            subcmd->operands ? " " : "",
-            subcmd->operands ? subcmd->operands : "",
-            OPTPARSE_HELP_INDENTATION_WIDTH, ' ');
-        if (n < divider_width) {
-            bprintf(buffer, "%*c", divider_width - n, ' ');
-        }
-        fprintf(stream, "%s", buffer);
-
-        if (subcmd->about) {
-            if (n > divider_width) {
-#if OPTPARSE_HELP_FLOATING_DESCRIPTIONS
-                blockprint(stream, subcmd->about, n, divider_width,
-                    OPTPARSE_HELP_MAX_LINE_WIDTH);
-#else
-                fprintf(stream, "\n%*c", divider_width, ' ');
-                blockprint(stream, subcmd->about, divider_width, divider_width,
-                    OPTPARSE_HELP_MAX_LINE_WIDTH);
+            break;
+        case ERROR_TYPE_UNKNOWN_COMMAND:
+            fprintf(stream, "Unknown command: \"%s\"\n", token);
+            break;
+        case ERROR_TYPE_MISSING_ARGUMENT:
+            if (!is_short) {
+                fprintf(stream, "Option \"--%s\" requires an argument.\n",
+                    token);
+            } else if (token[1] != '\0') {
+                fprintf(stream, "Option -%c (in sequence \"%s\")"
+                    " requires an argument.\n", *token, arg);
+            } else {
+                fprintf(stream, "Option -%c requires an argument.\n", *token);
+            }
+            break;
+        case ERROR_TYPE_UNWANTED_ARGUMENT:
+            fprintf(stream, "Unwanted option-argument: \"%s\"\n", token);
+            break;
+        case ERROR_TYPE_INVALID_ARGUMENT:
+            fprintf(stream, is_list ? "List item not valid: \"%s\"\n"
+                : "Argument not valid: \"%s\"\n", token);
+            break;
+        case ERROR_TYPE_OUT_OF_RANGE:
+            fprintf(stream, is_list ? "List item out of range: \"%s\"\n"
+                : "Value out of range: \"%s\"\n", token);
+            break;
+        case ERROR_TYPE_RESPONSE_FILE:
+            fprintf(stream, "Response file not valid or nested too deeply: "
+                "\"%s\"\n", token);
+            break;
+        case ERROR_TYPE_TOO_MANY_ITEMS:
+#if OPTPARSE_LIST_SUPPORT
+            fprintf(stream, "Too many list items (at most %zu): \"%s\"\n",
+                error->opt->arg_storage_capacity, token);
 #endif
+            break;
+        case ERROR_TYPE_FILE_ERROR:
+            if (strcmp(token, "-") == 0) {
+                fprintf(stream, "Could not read standard input.\n");
             } else {
-                blockprint(stream, subcmd->about, divider_width, divider_width,
-                    OPTPARSE_HELP_MAX_LINE_WIDTH);
+                fprintf(stream, "Could not read file: \"%s\"\n", token);
             }
-        } else {
-            fprintf(stream, "\n");
-        }
-
-        subcmd++;
+            break;
+        case ERROR_TYPE_MUTUALLY_EXCLUSIVE:
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+            {
+                char buffer1[OPTPARSE_PRINT_BUFFER_SIZE];
+                buffer1[0] = '\0';
+                char buffer2[OPTPARSE_PRINT_BUFFER_SIZE];
+                buffer2[0] = '\0';
+                bprint_option_name(buffer1, error->conflicting_opt);
+                bprint_option_name(buffer2, error->opt);
+                fprintf(stream, "Options %s and %s are mutually exclusive.\n",
+                    buffer1, buffer2);
+            }
+#endif
+            break;
     }
 }
-#endif
 
-// Prints a command's complete help information: about, usage, description,
-// options, subcommands.
-// cmd_chain: a NULL-terminated array that contains a valid command chain
-static void print_help(FILE *stream, struct optparse_cmd *cmd, int exit_status)
+// Builds the lookup tables of the command tree *cmd.
+void optparse_compile(struct optparse_cmd *cmd)
 {
-    if (stream != stderr && cmd->about) {
-        blockprint(stream, cmd->about, 0, 0, OPTPARSE_HELP_MAX_LINE_WIDTH);
-    }
-
-    // Print command's usage.
-    print_usage(stream, cmd);
-
-    // Print command's description.
-    if (cmd->description) {
-        fprintf(stream, "\n");
-        blockprint(stream, cmd->description, 0, 0,
-            OPTPARSE_HELP_MAX_LINE_WIDTH);
-    }
-
-    // Print command's options.
-    if (cmd->options) {
-#if OPTPARSE_HELP_LETTER_CASE == 0
-        fprintf(stream, "\nOptions:\n");
-#elif OPTPARSE_HELP_LETTER_CASE == 1
-        fprintf(stream, "\noptions:\n");
-#elif OPTPARSE_HELP_LETTER_CASE == 2
-        fprintf(stream, "\nOPTIONS:\n");
-#endif
-        print_options(stream, cmd->options);
-    }
+    int n_opts = 0;
+    size_t n_cmds = 0;
+    cmd->_compiled = compile(cmd, &n_opts, &n_cmds) ? -1 : 1;
+}
 
-#if OPTPARSE_SUBCOMMANDS
-    // Print list of subcommands.
-    if (cmd->subcommands) {
-#if OPTPARSE_HELP_LETTER_CASE == 0
-        fprintf(stream, "\nCommands:\n");
-#elif OPTPARSE_HELP_LETTER_CASE == 1
-        fprintf(stream, "\ncommands:\n");
-#elif OPTPARSE_HELP_LETTER_CASE == 2
-        fprintf(stream, "\nCOMMANDS:\n");
+// Frees the lookup tables and cached help screens of the command tree *cmd.
+void optparse_release(struct optparse_cmd *cmd)
+{
+#if !OPTPARSE_NO_HEAP // Otherwise, no lookup tables are built.
+    if (cmd->_index) {
+#if !OPTPARSE_HELP_PRERENDERED
+        free(cmd->_index->help);
 #endif
-        print_subcommands(stream, cmd->subcommands);
+        free(cmd->_index);
+        cmd->_index = NULL;
     }
 #endif
-
-    exit(exit_status);
-}
+    cmd->_compiled = 0;
 
 #if OPTPARSE_SUBCOMMANDS
-// Parses a command chain and returns the subcommmand the chain leads to.
-// Errors out if the chain is invalid.
-static struct optparse_cmd *read_cmd_chain(struct optparse_cmd *cmd,
-    char **argv)
-{
-    if (*argv && cmd->subcommands) {
+    if (cmd->subcommands) {
         struct optparse_cmd *subcmd = cmd->subcommands;
         while (subcmd->name != END_OF_SUBCOMMANDS) {
-            if (strcmp(subcmd->name, *argv) == 0) {
-                return read_cmd_chain(subcmd, ++argv);
-            }
+            optparse_release(subcmd);
             subcmd++;
         }
-
-        optparse_error("Unknown command: \"%s\"\n", *argv);
-        return NULL; // To satisfy the compiler.
-    } else {
-        return cmd;
     }
-}
 #endif
+}
 
-#ifndef NDEBUG
-// Recursively checks a command's option structure for impossible/faulty setups.
-static void check_cmd(struct optparse_cmd *cmd)
+#if OPTPARSE_COMPILED_TREES
+// Compiles the option lookup tables of the command tree *cmd into a buffer.
+size_t optparse_compile_tree(struct optparse_cmd *cmd, void *buffer,
+    size_t size)
 {
-    // The command's name is required.
-    assert(cmd->name != NULL);
-
-    if (cmd->options) {
-        struct optparse_opt *opt = cmd->options;
-        while (opt->short_name != (char) END_OF_OPTIONS) {
-            // At least one of those is required.
-#if OPTPARSE_LONG_OPTIONS
-            assert(opt->short_name || opt->long_name);
-#else
-            assert(opt->short_name);
-#endif
+    size_t sizes[TREE_HEADER_LEN] = {0};
+    uint32_t header[TREE_HEADER_LEN];
+    measure_tree(cmd, sizes);
+    if (get_tree_header(sizes, header)) {
+        return 0;
+    }
+    if (header[TREE_SIZE] > size) {
+        return header[TREE_SIZE];
+    }
 
-            // Make sure option-argument is named properly.
-            assert((opt->arg_name && opt->arg_name[0] == '['
-                && opt->arg_name[strlen(opt->arg_name) - 1] == ']')
-                || (opt->arg_name && opt->arg_name[0] != '[')
-                || !opt->arg_name);
+    unsigned char *tree = buffer;
+    memset(tree, 0, header[TREE_SIZE]);
+    for (size_t i = 0; i < TREE_HEADER_LEN; i++) {
+        write_u32(tree, i, header[i]);
+    }
+    size_t ids[TREE_HEADER_LEN] = {0};
+    write_compiled_cmd(tree, cmd, ids);
+    return header[TREE_SIZE];
+}
 
-#if OPTPARSE_LIST_SUPPORT
-            // .arg_storage_size requires .arg_delim and .arg_storage.
-            assert((opt->arg_storage_size && opt->arg_delim && opt->arg_storage)
-                || !opt->arg_storage_size);
+// Makes the command tree *cmd look up its options in a compiled tree.
+int optparse_load_tree(struct optparse_cmd *cmd, const void *tree, size_t size)
+{
+    const unsigned char *t = tree;
+    if (size < TREE_HEADER_LEN * sizeof (uint32_t)
+            || read_u32(t, TREE_MAGIC) != COMPILED_TREE_MAGIC
+            || read_u32(t, TREE_SIZE) != size
+            || read_u32(t, TREE_CMDS) != TREE_HEADER_LEN * sizeof (uint32_t)
+            || read_u32(t, TREE_N_CMDS) > (size - read_u32(t, TREE_CMDS))
+                / (TREE_CMD_LEN * sizeof (uint32_t))) {
+        return -1;
+    }
 
-            // Splitting and then calling like a non-array type-converted value
-            // existed would produce random values.
-            assert((opt->arg_delim && opt->function_type != FUNCTION_TYPE_TARG)
-                || !opt->arg_delim);
+    // Check that the command records match the command tree, and that the
+    // header matches the layout they imply.
+    size_t ids[TREE_HEADER_LEN] = {0};
+    uint32_t header[TREE_HEADER_LEN];
+    if (check_compiled_cmd(t, cmd, ids)
+            || read_u32(t, TREE_POOL) > size) {
+        return -1;
+    }
+    ids[TREE_POOL] = size - read_u32(t, TREE_POOL);
+    if (get_tree_header(ids, header)) {
+        return -1;
+    }
+    for (size_t i = 0; i < TREE_HEADER_LEN; i++) {
+        if (read_u32(t, i) != header[i]) {
+            return -1;
+        }
+    }
+    if (check_compiled_tables(t)) {
+        return -1;
+    }
 
-            // If the option-argument is not split, no array exists and array
-            // functions must not be called.
-            assert((!opt->arg_delim && opt->function_type
-                != FUNCTION_TYPE_TARG_ARRAY && opt->function_type
-                != FUNCTION_TYPE_OARG_ARRAY) || opt->arg_delim);
+    size_t n_cmds = 0;
+    load_compiled_cmd(t, cmd, &n_cmds);
+    optparse_compile(cmd);
+    return 0;
+}
 #endif
 
-#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
-            // Group values must not be larger than
-            // OPTPARSE_MUTUALLY_EXCLUSIVE_GROUPS_MAX.
-            assert((opt->group && opt->group < OPTPARSE_MUTUALLY_EXCLUSIVE_GROUPS_MAX)
-                || !opt->group);
-#endif
+#if !OPTPARSE_HELP_PRERENDERED && !OPTPARSE_NO_HEAP
+// Prints C source code that defines the help screens of the command tree *cmd.
+int optparse_fprint_prerendered_help(FILE *stream, struct optparse_cmd *cmd)
+{
+    int n_opts = 0;
+    size_t n_cmds = 0;
+    if (compile(cmd, &n_opts, &n_cmds)) {
+        return -1;
+    }
 
-            opt++;
-        }
+    size_t (*lens)[2] = malloc(n_cmds * sizeof *lens);
+    if (lens == NULL) {
+        return -1;
     }
 
-#if OPTPARSE_SUBCOMMANDS
-    if (cmd->subcommands) {
-        struct optparse_cmd *subcmd = cmd->subcommands;
-        while (subcmd->name != END_OF_SUBCOMMANDS) {
-            check_cmd(subcmd);
-            subcmd++;
-        }
+    fputs("// Generated by optparse_fprint_prerendered_help(). Do not edit.\n\n"
+        "#include \"optparse99.h\"\n", stream);
+    size_t id = 0;
+    if (print_prerendered_help(stream, cmd, &id, lens)) {
+        free(lens);
+        return -1;
     }
-#endif
+    fputs("\nconst struct optparse_prerendered_help "
+        "optparse_prerendered_help[] = {\n", stream);
+    for (size_t i = 0; i < n_cmds; i++) {
+        fprintf(stream, "    { help_%zu, %zu, %zu },\n", i, lens[i][0],
+            lens[i][1]);
+    }
+    fputs("};\n", stream);
+
+    free(lens);
+    return ferror(stream) ? -1 : 0;
 }
 #endif
 
-/// Public functions -----------------------------------------------------------
-
-// Parses command line options as described in the provided command structure.
-void optparse_parse(struct optparse_cmd *cmd, int *argc, char ***argv)
+#if !OPTPARSE_GENERATED_PARSER && !OPTPARSE_NO_HEAP
+// Prints C source code that defines specialized option lookup and execution
+// functions for the command tree *cmd.
+int optparse_fprint_generated_parser(FILE *stream, struct optparse_cmd *cmd)
 {
-#ifndef NDEBUG
-    check_cmd(cmd);
-#endif
+    int n_opts = 0;
+    size_t n_cmds = 0;
+    if (compile(cmd, &n_opts, &n_cmds)) {
+        return -1;
+    }
 
-    help_stream = stdout;
-    optparse_main_cmd = cmd;
-    if (optparse_main_cmd) {
-        parse(argc, argv, optparse_main_cmd);
+    fputs("// Generated by optparse_fprint_generated_parser(). Do not edit.\n\n"
+        "#include \"optparse99.h\"\n", stream);
+#if OPTPARSE_LONG_OPTIONS
+    if (has_long_names(cmd)) {
+        fputs("\n#include <string.h>\n", stream);
+        fputs(perfect_hash_code, stream);
+    }
+#endif
+    size_t id = 0;
+    if (print_generated_cmd(stream, cmd, &id)) {
+        return -1;
+    }
+    fputs("\nconst struct optparse_generated_cmd optparse_generated_parser[] = "
+        "{\n", stream);
+    for (size_t i = 0; i < n_cmds; i++) {
+#if OPTPARSE_LONG_OPTIONS
+        fprintf(stream, "    { find_short_%zu, find_long_%zu, execute_%zu },\n",
+            i, i, i);
+#else
+        fprintf(stream, "    { find_short_%zu, NULL, execute_%zu },\n", i, i);
+#endif
     }
+    fputs("};\n", stream);
+
+    return ferror(stream) ? -1 : 0;
 }
+#endif
 
 // Advances the parser index by 1 and returns the next command line argument.
 char *optparse_shift(void)
 {
-    if (args == NULL) {
+    return optparse_shift_ctx(get_ctx());
+}
+
+// Same as optparse_shift(), but for the context *ctx.
+char *optparse_shift_ctx(struct optparse_ctx *ctx)
+{
+    if (ctx->args == NULL) {
         return NULL;
     }
 
-    if (args[args_index] == NULL) {
+    if (ctx->args[ctx->args_index] == NULL) {
         return NULL;
     } else {
-        return args[++args_index];
+#if OPTPARSE_RESPONSE_FILES
+        while (expand_response_file(ctx, ctx->args_index + 1) == 0);
+#endif
+        return ctx->args[++ctx->args_index];
     }
 }
 
 // Undoes the previously called optparse_shift().
 char *optparse_unshift(void)
 {
-    if (args == NULL) {
+    return optparse_unshift_ctx(get_ctx());
+}
+
+// Same as optparse_unshift(), but for the context *ctx.
+char *optparse_unshift_ctx(struct optparse_ctx *ctx)
+{
+    if (ctx->args == NULL) {
         return NULL;
     }
 
-    if (args_index > 0) {
-        return args[--args_index];
+    if (ctx->args_index > 0) {
+        return ctx->args[--ctx->args_index];
     } else {
         return NULL;
     }
@@ -1442,31 +5698,51 @@ char *optparse_unshift(void)
 // Prints the currently active command's help information.
 void optparse_print_help(void)
 {
-#if OPTPARSE_SUBCOMMANDS
-    print_help(help_stream, active_cmd, EXIT_SUCCESS);
-#else
-    print_help(help_stream, optparse_main_cmd, EXIT_SUCCESS);
-#endif
+    struct optparse_ctx *ctx = get_ctx();
+    print_help(ctx, ctx->help_stream, ctx->active_cmd);
+    quit(ctx, EXIT_SUCCESS);
 }
 
 // Same as optparse_print_help, but prints to the specified stream. Exits with
 // the provided exit status.
 void optparse_fprint_help(FILE *stream, int exit_status)
 {
-#if OPTPARSE_SUBCOMMANDS
-    print_help(stream, active_cmd, exit_status);
-#else
-    print_help(stream, optparse_main_cmd, exit_status);
-#endif
+    optparse_fprint_help_ctx(get_ctx(), stream, exit_status);
+}
+
+// Same as optparse_fprint_help(), but for the context *ctx.
+void optparse_fprint_help_ctx(struct optparse_ctx *ctx, FILE *stream,
+    int exit_status)
+{
+    print_help(ctx, stream, ctx->active_cmd);
+    quit(ctx, exit_status);
 }
 
 // Prints the currently active command's usage information only.
 void optparse_fprint_usage(FILE *stream)
 {
-#if OPTPARSE_SUBCOMMANDS
-    print_usage(stream, active_cmd);
+    optparse_fprint_usage_ctx(get_ctx(), stream);
+}
+
+// Same as optparse_fprint_usage(), but for the context *ctx.
+void optparse_fprint_usage_ctx(struct optparse_ctx *ctx, FILE *stream)
+{
+#if OPTPARSE_HELP_PRERENDERED
+    const struct optparse_prerendered_help *help =
+        &optparse_prerendered_help[get_cmd_id(ctx->active_cmd)];
+    fwrite(help->text + help->about_len, 1, help->usage_len, stream);
+#else
+#if OPTPARSE_NO_HEAP
+    struct help_buffer hb = { .ctx = ctx, .stream = stream };
+    print_usage(&hb, ctx->active_cmd);
 #else
-    print_usage(stream, optparse_main_cmd);
+    struct help_buffer hb = { .ctx = ctx };
+    print_usage(&hb, ctx->active_cmd);
+    if (hb.len) {
+        fwrite(hb.data, 1, hb.len, stream);
+    }
+    free(hb.data);
+#endif
 #endif
 }
 
@@ -1476,13 +5752,18 @@ void optparse_fprint_usage(FILE *stream)
 void optparse_print_help_subcmd(int argc, char **argv)
 {
     (void) argc; // To avoid compilers complaining about "unused parameter".
+    struct optparse_ctx *ctx = get_ctx();
     argv++; // To ignore the program's file name
     if (*argv) {
-        struct optparse_cmd *subcmd = read_cmd_chain(optparse_main_cmd, argv);
-        print_help(stdout, subcmd, EXIT_SUCCESS);
+        struct optparse_cmd *subcmd = read_cmd_chain(ctx, ctx->main_cmd, argv);
+        if (subcmd == NULL) {
+            return;
+        }
+        print_help(ctx, stdout, subcmd);
     } else {
-        print_help(stdout, optparse_main_cmd, EXIT_SUCCESS);
+        print_help(ctx, stdout, ctx->main_cmd);
     }
+    quit(ctx, EXIT_SUCCESS);
 }
 #endif
 
@@ -1499,6 +5780,18 @@ int strtox(char *str, void *x, enum optparse_data_type data_type)
         return 1;
     }
 
+    long long min;
+    unsigned long long max;
+    if (get_int_range(data_type, &min, &max)) {
+        return strtoint(str, x, data_type, min, max);
+    }
+#if USE_FAST_FLOATS
+    if ((data_type == DATA_TYPE_FLT || data_type == DATA_TYPE_DBL)
+            && strtofp_fast(str, strlen(str), x, data_type) == 0) {
+        return 0;
+    }
+#endif
+
     char *endptr = NULL;
     errno = 0;
 
@@ -1524,59 +5817,12 @@ int strtox(char *str, void *x, enum optparse_data_type data_type)
             }
             *(unsigned char *) x = str[0];
             break;
-        case DATA_TYPE_SHRT:
-            {
-                long result = strtol(str, &endptr, 0);
-                if (result < SHRT_MIN || result > SHRT_MAX) {
-                    errno = ERANGE;
-                }
-                *(short *) x = (short) result;
-            }
-            break;
-        case DATA_TYPE_USHRT:
-            {
-                unsigned long result = strtoul(str, &endptr, 0);
-                if (result > USHRT_MAX) {
-                    errno = ERANGE;
-                }
-                *(unsigned short *) x = (unsigned short) result;
-            }
-            break;
-        case DATA_TYPE_INT:
-            {
-                long result = strtol(str, &endptr, 0);
-                if (result < INT_MIN || result > INT_MAX) {
-                    errno = ERANGE;
-                }
-                *(int *) x = (int) result;
-            }
-            break;
-        case DATA_TYPE_UINT:
-            {
-                unsigned long result = strtoul(str, &endptr, 0);
-                if (result > UINT_MAX) {
-                    errno = ERANGE;
-                }
-                *(unsigned int *) x = (unsigned int) result;
-            }
-            break;
-        case DATA_TYPE_LONG:
-            *(long *) x = strtol(str, &endptr, 0);
-            break;
-        case DATA_TYPE_ULONG:
-            *(unsigned long *) x = strtoul(str, &endptr, 0);
-            break;
-        case DATA_TYPE_LLONG:
-            *(long long *) x = strtoll(str, &endptr, 0);
-            break;
-        case DATA_TYPE_ULLONG:
-            *(unsigned long long *) x = strtoull(str, &endptr, 0);
-            break;
 #if OPTPARSE_FLOATING_POINT_SUPPORT
         case DATA_TYPE_FLT:
             {
                 double result = strtod(str, &endptr);
-                if (result < FLT_MIN || result > FLT_MAX) {
+                if (result < -FLT_MAX || result > FLT_MAX
+                        || (result != 0 && (float) result == 0)) {
                     errno = ERANGE;
                 }
                 *(float *) x = (float) result;
@@ -1590,113 +5836,19 @@ int strtox(char *str, void *x, enum optparse_data_type data_type)
             break;
 #endif
         case DATA_TYPE_BOOL:
-            {
-                int len = strlen(str);
-                char temp[len + 1];
-                strcpy(temp, str);
-                for (int i = 0; i < len; i++) {
-                    temp[i] = tolower(temp[i]);
-                }
-                if (strcmp(temp, "true") == 0) {
-                    *(bool *) x = true;
-                } else if (strcmp(temp, "false") == 0) {
-                    *(bool *) x = false;
-                } else if (strcmp(temp, "enabled") == 0) {
-                    *(bool *) x = true;
-                } else if (strcmp(temp, "disabled") == 0) {
-                    *(bool *) x = false;
-                } else if (strcmp(temp, "yes") == 0) {
-                    *(bool *) x = true;
-                } else if (strcmp(temp, "no") == 0) {
-                    *(bool *) x = false;
-                } else if (strcmp(temp, "on") == 0) {
-                    *(bool *) x = true;
-                } else if (strcmp(temp, "off") == 0) {
-                    *(bool *) x = false;
-                } else {
-                    int result = strtox(str, x, DATA_TYPE_INT);
-                    if (result == 1 || result == 0) {
-                        *(bool *) x = result;
-                    } else {
-                        endptr = str;
-                    }
-                }
-            }
-            break;
-#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
-        case DATA_TYPE_INT8:
-            {
-                long result = strtol(str, &endptr, 0);
-                if (result < INT8_MIN || result > INT8_MAX) {
-                    errno = ERANGE;
-                }
-                *(int8_t *) x = (int8_t) result;
-            }
-            break;
-        case DATA_TYPE_UINT8:
-            {
-                unsigned long result = strtoul(str, &endptr, 0);
-                if (result > UINT8_MAX) {
-                    errno = ERANGE;
-                }
-                *(uint8_t *) x = (uint8_t) result;
-            }
-            break;
-        case DATA_TYPE_INT16:
-            {
-                long result = strtol(str, &endptr, 0);
-                if (result < INT16_MIN || result > INT16_MAX) {
-                    errno = ERANGE;
-                }
-                *(int16_t *) x = (int16_t) result;
-            }
-            break;
-        case DATA_TYPE_UINT16:
-            {
-                unsigned long result = strtoul(str, &endptr, 0);
-                if (result > UINT16_MAX) {
-                    errno = ERANGE;
-                }
-                *(uint16_t *) x = (uint16_t) result;
-            }
-            break;
-        case DATA_TYPE_INT32:
-            {
-                long result = strtol(str, &endptr, 0);
-                if (result < INT32_MIN || result > INT32_MAX) {
-                    errno = ERANGE;
-                }
-                *(int32_t *) x = (int32_t) result;
-            }
-            break;
-        case DATA_TYPE_UINT32:
-            {
-                unsigned long result = strtoul(str, &endptr, 0);
-                if (result > UINT32_MAX) {
-                    errno = ERANGE;
-                }
-                *(uint32_t *) x = (uint32_t) result;
-            }
-            break;
-        case DATA_TYPE_INT64:
-            {
-                long long result = strtoll(str, &endptr, 0);
-                if (result < INT64_MIN || result > INT64_MAX) {
-                    errno = ERANGE;
+            if (match_bool(str, strlen(str), x)) {
+                // Other than keywords, integers are accepted; non-zero is true.
+                long long i;
+                int ret = strtoint(str, &i, DATA_TYPE_LLONG, LLONG_MIN,
+                    LLONG_MAX);
+                if (ret) {
+                    return ret;
                 }
-                *(int64_t *) x = (int64_t) result;
+                *(_Bool *) x = i != 0;
             }
             break;
-        case DATA_TYPE_UINT64:
-            {
-                unsigned long long result = strtoull(str, &endptr, 0);
-                if (result > UINT64_MAX) {
-                    errno = ERANGE;
-                }
-                *(uint64_t *) x = (uint64_t) result;
-            }
+        default: // Integer types are handled by strtoint().
             break;
-#endif
     }
 
     if (endptr && (endptr == str || endptr[0] != '\0')) {
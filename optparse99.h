@@ -59,6 +59,12 @@ SOFTWARE.
 #define OPTPARSE_LIST_SUPPORT true
 #endif
 
+// Enables reading lists from files and standard input (see .arg_from_file).
+// Requires OPTPARSE_LIST_SUPPORT.
+#ifndef OPTPARSE_LIST_FILES
+#define OPTPARSE_LIST_FILES true
+#endif
+
 #ifndef OPTPARSE_FLOATING_POINT_SUPPORT
 #define OPTPARSE_FLOATING_POINT_SUPPORT true
 #endif
@@ -67,6 +73,77 @@ SOFTWARE.
 #define OPTPARSE_C99_INTEGER_TYPES_SUPPORT true
 #endif
 
+// Enables optparse_parse_batch() to parse on multiple threads. Requires POSIX
+// threads.
+// Default value: true on Unix-like systems, otherwise false
+#ifndef OPTPARSE_BATCH_THREADS
+#if defined __unix__ || defined __APPLE__
+#define OPTPARSE_BATCH_THREADS true
+#else
+#define OPTPARSE_BATCH_THREADS false
+#endif
+#endif
+
+// Enables optparse_parse_config(), which reads option values from
+// configuration files. Requires OPTPARSE_LONG_OPTIONS.
+// Default value: true
+#ifndef OPTPARSE_CONFIG_FILES
+#define OPTPARSE_CONFIG_FILES true
+#endif
+
+// Enables response files: command line arguments of the form "@FILE" are
+// replaced with the arguments contained in FILE.
+// Default value: false
+#ifndef OPTPARSE_RESPONSE_FILES
+#define OPTPARSE_RESPONSE_FILES false
+#endif
+
+// The maximum number of response files expanded per parsing run, which also
+// stops response files from including themselves endlessly.
+// Default value: 64
+#ifndef OPTPARSE_RESPONSE_FILES_MAX
+#define OPTPARSE_RESPONSE_FILES_MAX 64
+#endif
+
+// Enables options to fall back to environment variables (see .env_name).
+// Default value: true on Unix-like systems, otherwise false
+#ifndef OPTPARSE_ENV_VARIABLES
+#if defined __unix__ || defined __APPLE__
+#define OPTPARSE_ENV_VARIABLES true
+#else
+#define OPTPARSE_ENV_VARIABLES false
+#endif
+#endif
+
+// Looks up and executes options through specialized code that was generated at
+// build time, by the CMake function optparse99_generate_parser(), instead of
+// through lookup tables and the option structures' type members.
+// Default value: false
+#ifndef OPTPARSE_GENERATED_PARSER
+#define OPTPARSE_GENERATED_PARSER false
+#endif
+
+// Enables optparse_compile_tree() and optparse_load_tree(), which store a
+// command tree's option lookup tables in a compact, read-only format that can
+// be shared between processes.
+// Default value: false
+#ifndef OPTPARSE_COMPILED_TREES
+#define OPTPARSE_COMPILED_TREES false
+#endif
+
+// Removes all calls to malloc(), realloc() and free(). Memory is then only
+// allocated through a context's custom allocator (see
+// optparse_set_allocator()), if it has one; otherwise, features that need
+// memory report ERROR_TYPE_OUT_OF_MEMORY. Lists fit without allocating if their
+// options set .arg_storage_capacity. Options and subcommands are looked up by
+// linear search, help screens are written while they are rendered,
+// optparse_parse_batch() always fails, and the code generators are not
+// available.
+// Default value: false
+#ifndef OPTPARSE_NO_HEAP
+#define OPTPARSE_NO_HEAP false
+#endif
+
 // Indentation width, in characters.
 // Default value: 2
 #ifndef OPTPARSE_HELP_INDENTATION_WIDTH
@@ -100,6 +177,14 @@ SOFTWARE.
 #define OPTPARSE_HELP_WORD_WRAP true
 #endif
 
+// Prints help screens that were rendered at build time, by the CMake function
+// optparse99_prerender_help(), instead of laying them out at runtime. The code
+// that renders help screens is then not compiled.
+// Default value: false
+#ifndef OPTPARSE_HELP_PRERENDERED
+#define OPTPARSE_HELP_PRERENDERED false
+#endif
+
 // Style used for automatic usage generation.
 // Default value: 0
 #ifndef OPTPARSE_HELP_USAGE_STYLE
@@ -130,10 +215,11 @@ SOFTWARE.
 #define OPTPARSE_PRINT_HELP_ON_ERROR true
 #endif
 
-// The maximum amount of groups for mutually exclusive options.
-// Default value: 8
-#ifndef OPTPARSE_MUTUALLY_EXCLUSIVE_GROUPS_MAX
-#define OPTPARSE_MUTUALLY_EXCLUSIVE_GROUPS_MAX 8
+// The maximum number of list items passed to a FUNCTION_TYPE_TARG_CHUNK
+// function at once.
+// Default value: 64
+#ifndef OPTPARSE_LIST_CHUNK_SIZE
+#define OPTPARSE_LIST_CHUNK_SIZE 64
 #endif
 
 // The size of the buffer used for printing functionality such as printing help
@@ -143,6 +229,13 @@ SOFTWARE.
 #define OPTPARSE_PRINT_BUFFER_SIZE 1024
 #endif
 
+// Additional keywords accepted by DATA_TYPE_BOOL, as comma-separated
+// {"keyword", value} pairs, e.g. {"ja", true}, {"nein", false}.
+// Default value: (none)
+#ifndef OPTPARSE_BOOL_KEYWORDS
+#define OPTPARSE_BOOL_KEYWORDS
+#endif
+
 /// Option structure -----------------------------------------------------------
 
 #define END_OF_OPTIONS -1 // Marks the end of an option array.
@@ -208,6 +301,13 @@ enum optparse_function_type {
                               // call:        f(TARG_ARRAY_SIZE, TARG_ARRAY);
     FUNCTION_TYPE_OARG_ARRAY, // declaration: void f(size_t, char **);
                               // call:        f(OARG_ARRAY_SIZE, OARG_ARRAY);
+    FUNCTION_TYPE_TARG_EACH,  // declaration: void f(DATA_TYPE);
+                              // call:        f(TARG); for each list item,
+                              // while the list is being converted
+    FUNCTION_TYPE_TARG_CHUNK, // declaration: void f(size_t, DATA_TYPE *);
+                              // call:        f(CHUNK_SIZE, CHUNK); for each
+                              // chunk of up to OPTPARSE_LIST_CHUNK_SIZE list
+                              // items, while the list is being converted
 #endif
     FUNCTION_TYPE_VOID,       // declaration: void f(void);
                               // call:        f();
@@ -230,16 +330,28 @@ struct optparse_opt {
     char *arg_delim;          // If set, the option-argument will be treated as
                               // a list whose items are separated by any of this
                               // string's characters.
+#if OPTPARSE_LIST_FILES
+    _Bool arg_from_file;      // If true, a list option-argument of the form
+                              // "@FILE" makes the list be read from FILE, and
+                              // "-" from standard input.
+#endif
 #endif
     void *arg_storage;        // The memory location the (type-converted)
                               // option-argument is saved to. Its data type must
                               // match the one defined in .arg_data_type. If
                               // .arg_delim is set, it must be a pointer (which
                               // after parsing will point to dynamically
-                              // allocated memory).
+                              // allocated memory), unless
+                              // .arg_storage_capacity is set.
 #if OPTPARSE_LIST_SUPPORT
     size_t *arg_storage_size; // The memory location the number of list items
                               // stored in *arg_storage is saved to.
+    size_t arg_storage_capacity;
+                              // If set, .arg_storage points to a caller-owned
+                              // array of this many items, which a list is
+                              // converted into without allocating memory.
+                              // Longer lists are reported as
+                              // ERROR_TYPE_TOO_MANY_ITEMS.
 #endif
     int *flag;                // A pointer to an integer variable that is to be
                               // used as specified by .flag_type.
@@ -253,6 +365,10 @@ struct optparse_opt {
 #if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
     int group;                // Options that share the same group value are
                               // treated as mutually exclusive.
+    int *groups;              // Further groups the option belongs to, as an
+                              // array terminated by 0. Like .group, group
+                              // values start at 1; groups beyond 255 need
+                              // memory from the context's allocator.
 #endif
 #if OPTPARSE_HIDDEN_OPTIONS
     _Bool hidden;             // If true, the option won't be displayed in the
@@ -260,6 +376,11 @@ struct optparse_opt {
 #endif
     char *description;        // A string that will appear as the option's
                               // documentation in the help screen.
+#if OPTPARSE_ENV_VARIABLES
+    char *env_name;           // If set, the environment variable of this name
+                              // is used if the option does not appear on the
+                              // command line.
+#endif
 };
 
 /// Command structure ----------------------------------------------------------
@@ -286,6 +407,223 @@ struct optparse_cmd {
                        // subcommands.
     struct optparse_cmd *_parent;
                        // Used internally to keep track of nested subcommands.
+#endif
+    struct optparse_index *_index;
+                       // Used internally to look up options.
+    int _compiled;     // Used internally: 1 once the command tree has been
+                       // compiled, -1 if its lookup tables are incomplete.
+};
+
+// A command's help screen, as rendered at build time (see
+// OPTPARSE_HELP_PRERENDERED). Commands are numbered depth-first, starting with
+// the root command at index 0 of optparse_prerendered_help[].
+struct optparse_prerendered_help {
+    const char *text;  // The complete help screen.
+    size_t about_len;  // The length of the text's leading "about" part, which
+                       // is left out when the help screen is printed to
+                       // stderr.
+    size_t usage_len;  // The length of the usage part that follows.
+};
+
+// A command's option lookup and execution functions, as generated at build time
+// (see OPTPARSE_GENERATED_PARSER). Commands are numbered depth-first, starting
+// with the root command at index 0 of optparse_generated_parser[].
+struct optparse_generated_cmd {
+    int (*find_short)(char short_name);
+                       // Returns the index of the command's option that has
+                       // the short name, or -1 if there is none.
+    int (*find_long)(const char *long_name);
+                       // Same as .find_short, for long names.
+    int (*execute)(struct optparse_opt *opt, int id, char *arg);
+                       // Executes the option *opt, whose index is id, like
+                       // optparse_parse() would outside of batch mode. Returns
+                       // strtox()'s return value for arg, or 2 for options
+                       // with lists, which are not handled.
+};
+
+/// Error structure ------------------------------------------------------------
+
+// Specifies the kind of a parsing error.
+enum optparse_error_type {
+    ERROR_TYPE_OUT_OF_MEMORY,
+    ERROR_TYPE_UNKNOWN_OPTION,      // .token: the option's name
+    ERROR_TYPE_UNKNOWN_COMMAND,     // .token: the command's name
+    ERROR_TYPE_MISSING_ARGUMENT,    // .token: the option's name
+    ERROR_TYPE_UNWANTED_ARGUMENT,   // .token: the option-argument
+    ERROR_TYPE_INVALID_ARGUMENT,    // .token: the option-argument or list item
+    ERROR_TYPE_OUT_OF_RANGE,        // .token: the option-argument or list item
+    ERROR_TYPE_MUTUALLY_EXCLUSIVE,  // .conflicting_opt: the option used before
+    ERROR_TYPE_FILE_ERROR,          // .token: the name of the list file that
+                                    // could not be read ("-" for standard
+                                    // input)
+    ERROR_TYPE_RESPONSE_FILE,       // .token: the name of a response file that
+                                    // is malformed or nested too deeply
+    ERROR_TYPE_TOO_MANY_ITEMS,      // .token: the first list item that exceeds
+                                    // the option's .arg_storage_capacity
+};
+
+// Describes a parsing error.
+struct optparse_error {
+    enum optparse_error_type type;
+    int index;                      // The index (in argv as it was before
+                                    // parsing) of the command line argument
+                                    // that caused the error.
+    char *arg;                      // That command line argument.
+    char *token;                    // The offending part of the argument. For
+                                    // short options, it points to the option
+                                    // character inside .arg.
+    struct optparse_opt *opt;       // The option involved, if any.
+    struct optparse_opt *conflicting_opt;
+                                    // See ERROR_TYPE_MUTUALLY_EXCLUSIVE.
+    size_t list_index;              // If .token is a list item: the item's
+                                    // position in the list (empty items not
+                                    // counted), starting at 0.
+};
+
+/// Batch structures -----------------------------------------------------------
+
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+#include <stdint.h>
+#endif
+
+// Can hold a (type-converted) option-argument of any data type.
+union optparse_data {
+    char *t_str;
+    char t_char;
+    signed char t_schar;
+    unsigned char t_uchar;
+    short t_shrt;
+    unsigned short t_ushrt;
+    int t_int;
+    unsigned int t_uint;
+    long t_long;
+    unsigned long t_ulong;
+    long long t_llong;
+    unsigned long long t_ullong;
+#if OPTPARSE_FLOATING_POINT_SUPPORT
+    float t_flt;
+    double t_dbl;
+    long double t_ldbl;
+#endif
+    _Bool t_bool;
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+    int8_t t_int8;
+    uint8_t t_uint8;
+    int16_t t_int16;
+    uint16_t t_uint16;
+    int32_t t_int32;
+    uint32_t t_uint32;
+    int64_t t_int64;
+    uint64_t t_uint64;
+#endif
+#if OPTPARSE_LIST_SUPPORT
+    void *t_array;                  // A list's dynamically allocated array.
+#endif
+};
+
+// Holds an option's result when parsing in batch mode, replacing the option's
+// .arg_storage, .arg_storage_size, and .flag.
+struct optparse_value {
+    int count;                      // The number of times the option was used.
+    int flag;                       // Modified as specified by .flag_type, if
+                                    // the option's .flag is set.
+    union optparse_data data;       // The last (type-converted)
+                                    // option-argument.
+#if OPTPARSE_LIST_SUPPORT
+    size_t list_size;               // The number of items in .data.t_array.
+#endif
+};
+
+// Describes an argument vector that is to be parsed by optparse_parse_batch().
+struct optparse_job {
+    int argc;                       // The vector's argc. After parsing: the
+                                    // number of operands, including argv[0].
+    char **argv;                    // The vector's argv. After parsing: the
+                                    // operands.
+    struct optparse_value *values;  // Caller-provided, zero-initialized array
+                                    // with one slot per option of the command
+                                    // tree (see optparse_count_options()).
+    struct optparse_cmd *cmd;       // After parsing: the command that would
+                                    // have been run.
+    int status;                     // After parsing: the same value
+                                    // optparse_parse_ctx() returns.
+    struct optparse_error error;    // After parsing: the first error, if any.
+};
+
+/// Allocator structures -------------------------------------------------------
+
+// Memory allocation callbacks (see optparse_set_allocator()). They must behave
+// like malloc(), realloc() and free(), and receive .user_data as their last
+// argument.
+struct optparse_allocator {
+    void *(*alloc)(size_t size, void *user_data);
+    void *(*realloc)(void *ptr, size_t size, void *user_data);
+    void (*free)(void *ptr, void *user_data);
+    void *user_data;
+};
+
+// A bump allocator that hands out caller-provided memory (see
+// optparse_arena_init()).
+// All members are used internally and should be ignored.
+struct optparse_arena {
+    unsigned char *buffer;          // The memory, suitably aligned.
+    size_t size;                    // Its size.
+    size_t used;                    // The number of bytes handed out.
+    size_t last;                    // The offset of the most recent allocation,
+                                    // which can grow in place; 0 if none.
+};
+
+/// Context structure ----------------------------------------------------------
+
+// Holds the state of a parsing process, which allows multiple argument vectors
+// to be parsed at the same time, e.g. by different threads. Must be
+// zero-initialized before its first use: struct optparse_ctx ctx = { 0 };
+// All members are used internally and should be ignored.
+struct optparse_ctx {
+    struct optparse_cmd *main_cmd;   // The command tree's root.
+    struct optparse_cmd *active_cmd; // The currently running command.
+    char **args;                     // The current state of argv while parsing.
+    int args_index;                  // The currently parsed argument's index.
+    int args_offset;                 // The number of arguments that have been
+                                     // removed from the front of argv.
+    FILE *help_stream;               // The stream help information is printed
+                                     // to.
+#if OPTPARSE_MUTUALLY_EXCLUSIVE_OPTIONS
+    unsigned char *groups_seen;      // Bit set of the groups whose options
+                                     // have been used so far.
+    struct optparse_opt **group_opts;
+                                     // The options that have been used so far,
+                                     // indexed by their group; only valid for
+                                     // the groups in .groups_seen.
+    int max_group;                   // The largest group value tracked in
+                                     // .groups_seen.
+#endif
+    _Bool collect_errors;            // See optparse_collect_errors().
+    struct optparse_error *errors;   // The caller-provided error array.
+    int errors_max;                  // The error array's size.
+    int n_errors;                    // The number of errors that occurred.
+    _Bool stopped;                   // Whether parsing has been stopped early.
+    struct optparse_value *values;   // If set, results are stored here instead
+                                     // (see struct optparse_job).
+    struct optparse_allocator allocator;
+                                     // See optparse_set_allocator_ctx().
+    _Bool track_allocations;         // See optparse_track_allocations_ctx().
+    void **allocations;              // The tracked allocations.
+    size_t n_allocations;            // Their number.
+    size_t allocations_capacity;     // The number .allocations can hold.
+#if OPTPARSE_RESPONSE_FILES
+    int n_response_files;            // The number of response files expanded.
+#endif
+#if OPTPARSE_CONFIG_FILES
+    char *config_path;               // The configuration file being parsed, if
+                                     // any.
+    int config_line;                 // The line being parsed in that file.
+#endif
+#if OPTPARSE_ENV_VARIABLES
+    _Bool *env_seen;                 // For each of the active command's
+                                     // options: whether it has been used.
+    char *env_var;                   // The environment string ("NAME=value")
+                                     // whose value is being used, if any.
 #endif
 };
 
@@ -295,6 +633,182 @@ struct optparse_cmd {
 // Modifies argc and argv to only contain non-option arguments.
 void optparse_parse(struct optparse_cmd *cmd, int *argc, char ***argv);
 
+// Same as optparse_parse(), but keeps the parser's state in the caller-provided
+// context *ctx instead of the default context, so that it can run on multiple
+// threads at the same time. On each thread, functions like optparse_shift()
+// or optparse_print_help(), when called during parsing (e.g. by an option's
+// .function), operate on the context that is being parsed.
+// If threads share a command tree, optparse_compile() must be called on it
+// before they start parsing.
+// Return value:  0: success (always, unless errors are collected)
+//               >0: the number of errors that occurred
+//               -1: parsing was stopped early, e.g. to print help information
+int optparse_parse_ctx(struct optparse_ctx *ctx, struct optparse_cmd *cmd,
+    int *argc, char ***argv);
+
+// Makes the context *ctx collect errors instead of quitting. While parsing,
+// recoverable errors are skipped and parsing continues, so that all of them
+// are found in a single run. The first errors_max errors are stored in the
+// caller-provided array errors. Help functions return instead of quitting, and
+// parsing stops after they have been called. A command's .function is not
+// called if an error occurred.
+void optparse_collect_errors(struct optparse_ctx *ctx,
+    struct optparse_error errors[], int errors_max);
+
+// Makes optparse_parse() allocate memory with the callbacks in *allocator
+// instead of malloc(), realloc() and free(); NULL restores those. This applies
+// to all memory that belongs to a parsing run, like list arrays stored to
+// .arg_storage, copies of option-arguments, and arrays of expanded arguments.
+// Lookup tables and help screens, which belong to the command tree, are always
+// allocated with malloc().
+void optparse_set_allocator(const struct optparse_allocator *allocator);
+
+// Same as optparse_set_allocator(), but for the context *ctx.
+void optparse_set_allocator_ctx(struct optparse_ctx *ctx,
+    const struct optparse_allocator *allocator);
+
+// Makes optparse_parse() track the memory it allocates (see
+// optparse_set_allocator()) if track is true, so that optparse_free_all() can
+// release it at once. Tracked memory must not be freed otherwise, and the
+// allocator must not change while there is any.
+void optparse_track_allocations(_Bool track);
+
+// Same as optparse_track_allocations(), but for the context *ctx.
+void optparse_track_allocations_ctx(struct optparse_ctx *ctx, _Bool track);
+
+// Frees all tracked memory that optparse_parse() has allocated since the last
+// call, e.g. list arrays stored to .arg_storage, which then must no longer be
+// used. Must not be called while parsing.
+void optparse_free_all(void);
+
+// Same as optparse_free_all(), but for the context *ctx.
+void optparse_free_all_ctx(struct optparse_ctx *ctx);
+
+// Prepares a bump allocator that hands out the caller-provided memory buffer
+// of the given size, to be used with optparse_arena_allocator(). Allocating is
+// cheap, freeing only reclaims the most recent allocation, and
+// optparse_arena_reset() releases all memory at once. If the buffer is used
+// up, allocations fail, which is reported as ERROR_TYPE_OUT_OF_MEMORY.
+void optparse_arena_init(struct optparse_arena *arena, void *buffer,
+    size_t size);
+
+// Returns callbacks that allocate from *arena, for optparse_set_allocator().
+struct optparse_allocator optparse_arena_allocator(
+    struct optparse_arena *arena);
+
+// Releases all memory allocated from *arena.
+void optparse_arena_reset(struct optparse_arena *arena);
+
+// Prints a parsing error's message, e.g. "Unknown option: "--foo"".
+void optparse_fprint_error(FILE *stream, struct optparse_error *error);
+
+// Parses the n_jobs argument vectors described by jobs[], using the command
+// tree *cmd, which is compiled and checked only once. The jobs are split across
+// n_threads threads (1: the calling thread only). Each job's results are stored
+// in its .values array, in which an option's slot is found at the option's
+// position in the tree (counting depth-first, starting with the root command's
+// options). Options' and commands' .function members are not called.
+// Errors are collected, so the program is never quit.
+// Return value: the number of jobs with a non-zero status; -1 if out of memory
+int optparse_parse_batch(struct optparse_cmd *cmd, struct optparse_job jobs[],
+    size_t n_jobs, int n_threads);
+
+// Returns the number of options in the command tree *cmd.
+size_t optparse_count_options(struct optparse_cmd *cmd);
+
+// Splits a non-literal string into shell-style words, in place, and stores
+// pointers to them in the caller-provided array argv, followed by NULL. Words
+// are separated by whitespace; quotes ('' and "") and backslashes work like in
+// a POSIX shell, but no expansions are performed. No memory is allocated.
+// Return value: >=0: the number of words stored in argv
+//                -1: argv has fewer than (number of words + 1) elements
+//                -2: the string ends inside quotes or with a backslash
+int optparse_tokenize(char *string, char *argv[], int argv_max);
+
+// Splits a non-literal string with optparse_tokenize() and parses the words as
+// command line arguments, using the context *ctx. argv[0] is set to cmd->name.
+// After parsing, argv contains only operands.
+// Return value: -2 if the string could not be split, otherwise the same value
+//               optparse_parse_ctx() returns
+int optparse_parse_string(struct optparse_ctx *ctx, struct optparse_cmd *cmd,
+    char *string, char *argv[], int argv_max);
+
+#if OPTPARSE_CONFIG_FILES && OPTPARSE_LONG_OPTIONS
+// Parses a configuration file, applying its values to the options of the
+// command tree *cmd as if they had been entered on the command line. Lines have
+// the form "LONG_NAME = VALUE" or "LONG_NAME", and sections ("[SUBCOMMAND...]")
+// refer to subcommands. To let the command line take precedence, this function
+// should be called before optparse_parse(); mutually exclusive options are only
+// checked within each call, though. The file is mapped into memory that is
+// never freed, unless the context tracks its allocations: it's then read into
+// tracked memory, which optparse_free_all() releases.
+// Return value: same as optparse_parse_ctx()'s; for errors, .arg is the file's
+// path and .index the line number
+int optparse_parse_config(struct optparse_cmd *cmd, const char *path);
+
+// Same as optparse_parse_config(), but uses the context *ctx.
+int optparse_parse_config_ctx(struct optparse_ctx *ctx,
+    struct optparse_cmd *cmd, const char *path);
+#endif
+
+#if OPTPARSE_HELP_PRERENDERED
+// The help screens of the command tree, in the source code printed by
+// optparse_fprint_prerendered_help().
+extern const struct optparse_prerendered_help optparse_prerendered_help[];
+#elif !OPTPARSE_NO_HEAP
+// Prints C source code that defines the help screens of the command tree *cmd
+// for use with OPTPARSE_HELP_PRERENDERED, as optparse_prerendered_help[].
+// Return value: 0 on success, -1 if the command tree could not be compiled or
+// rendered
+int optparse_fprint_prerendered_help(FILE *stream, struct optparse_cmd *cmd);
+#endif
+
+#if OPTPARSE_GENERATED_PARSER
+// The option lookup and execution functions of the command tree, in the source
+// code printed by optparse_fprint_generated_parser().
+extern const struct optparse_generated_cmd optparse_generated_parser[];
+#elif !OPTPARSE_NO_HEAP
+// Prints C source code that defines specialized option lookup and execution
+// functions for the command tree *cmd, for use with OPTPARSE_GENERATED_PARSER,
+// as optparse_generated_parser[].
+// Return value: 0 on success, -1 if the command tree could not be compiled or a
+// long option table could not be built
+int optparse_fprint_generated_parser(FILE *stream, struct optparse_cmd *cmd);
+#endif
+
+// Builds the lookup tables of the command tree *cmd, so that options and
+// subcommands are found in constant time regardless of their number. Calling it
+// is optional, as optparse_parse() builds missing tables on first use, but it
+// allows doing the work at a time of the program's choosing.
+void optparse_compile(struct optparse_cmd *cmd);
+
+// Frees the lookup tables and cached help screens of the command tree *cmd, so
+// that it can be freed or modified; it's compiled again on next use. The
+// command tree must not be in use, and a loaded compiled tree has to be loaded
+// again.
+void optparse_release(struct optparse_cmd *cmd);
+
+#if OPTPARSE_COMPILED_TREES
+// Writes the option lookup tables of the command tree *cmd to buffer, as a
+// compiled tree: a block of memory without pointers that can be stored, placed
+// anywhere, and loaded with optparse_load_tree(). Nothing is written if size is
+// too small.
+// Return value: the compiled tree's size, or 0 if the command tree is too large
+size_t optparse_compile_tree(struct optparse_cmd *cmd, void *buffer,
+    size_t size);
+
+// Makes optparse_parse() look up the long options of the command tree *cmd in a
+// compiled tree of the given size, which optparse_compile_tree() has written
+// for the same command tree, with the same macros, on a machine of the same
+// byte order; short options are looked up in a table that is built as usual.
+// The compiled tree is only read, and must stay in place while the command tree
+// is in use.
+// Return value: 0 on success, -1 if the compiled tree is damaged or does not
+// fit the command tree
+int optparse_load_tree(struct optparse_cmd *cmd, const void *tree,
+    size_t size);
+#endif
+
 // Prints the currently active command's full help information, listing
 // available options and their descriptions. It can be called manuall or through
 // an option's function member. Exits with exit status EXIT_SUCCESS.
@@ -304,9 +818,16 @@ void optparse_print_help(void);
 // the specified stream and exits with the provided exit status.
 void optparse_fprint_help(FILE *stream, int exit_status);
 
+// Same as optparse_fprint_help(), but for the context *ctx.
+void optparse_fprint_help_ctx(struct optparse_ctx *ctx, FILE *stream,
+    int exit_status);
+
 // Prints the currently active command's usage information only.
 void optparse_fprint_usage(FILE *stream);
 
+// Same as optparse_fprint_usage(), but for the context *ctx.
+void optparse_fprint_usage_ctx(struct optparse_ctx *ctx, FILE *stream);
+
 #if OPTPARSE_SUBCOMMANDS
 // Prints a subcommand's help by parsing remaining operands. To be used as a
 // command structure's .function member.
@@ -318,11 +839,17 @@ void optparse_print_help_subcmd(int argc, char **argv);
 // running, the return value is NULL.
 char *optparse_shift(void);
 
+// Same as optparse_shift(), but for the context *ctx.
+char *optparse_shift_ctx(struct optparse_ctx *ctx);
+
 // Undoes the previously called optparse_shift() and returns the previous
 // command line argument. Must be called in the same function and is only
 // guaranteed to undo the most recent shift.
 char *optparse_unshift(void);
 
+// Same as optparse_unshift(), but for the context *ctx.
+char *optparse_unshift_ctx(struct optparse_ctx *ctx);
+
 // Converts a string to different data type. Can, for example, be used to
 // manually convert option-arguments retreived by optparse_shift().
 // Return value:  0: success
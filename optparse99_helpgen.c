@@ -0,0 +1,31 @@
+// Prints the pre-rendered help screens of a command tree as C source code (see
+// OPTPARSE_HELP_PRERENDERED), to the file named by the first argument or to
+// standard output. It is built and run by the CMake function
+// optparse99_prerender_help(). OPTPARSE_HELPGEN_TREE must name the command
+// tree's root command, which is to be defined with external linkage.
+
+#include "optparse99.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern struct optparse_cmd OPTPARSE_HELPGEN_TREE;
+
+int main(int argc, char *argv[])
+{
+    FILE *stream = stdout;
+    if (argc > 1) {
+        stream = fopen(argv[1], "w");
+        if (stream == NULL) {
+            perror(argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optparse_fprint_prerendered_help(stream, &OPTPARSE_HELPGEN_TREE)
+            || fclose(stream)) {
+        fprintf(stderr, "Could not write help screens.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
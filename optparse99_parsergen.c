@@ -0,0 +1,31 @@
+// Prints the specialized option lookup and execution functions of a command
+// tree as C source code (see OPTPARSE_GENERATED_PARSER), to the file named by
+// the first argument or to standard output. It is built and run by the CMake
+// function optparse99_generate_parser(). OPTPARSE_PARSERGEN_TREE must name the
+// command tree's root command, which is to be defined with external linkage.
+
+#include "optparse99.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern struct optparse_cmd OPTPARSE_PARSERGEN_TREE;
+
+int main(int argc, char *argv[])
+{
+    FILE *stream = stdout;
+    if (argc > 1) {
+        stream = fopen(argv[1], "w");
+        if (stream == NULL) {
+            perror(argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optparse_fprint_generated_parser(stream, &OPTPARSE_PARSERGEN_TREE)
+            || fclose(stream)) {
+        fprintf(stderr, "Could not write the generated parser.\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
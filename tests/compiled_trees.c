@@ -0,0 +1,148 @@
+// Checks that optparse_load_tree() loads an intact compiled tree, and rejects
+// compiled trees whose long option tables or long names are damaged.
+
+#include "optparse99.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The compiled tree's layout, as described in optparse99.c: the indexes of the
+// header's 32-bit integers,
+enum {
+    HEADER_N_OPTS = 3,
+    HEADER_CMDS = 4,
+    HEADER_NAME_OFFSETS = 6,
+    HEADER_NAME_LENS = 7,
+    HEADER_SLOTS = 8,
+};
+
+// and of a command record's.
+enum {
+    CMD_SLOTS = 2,
+    CMD_SLOTS_MASK = 3,
+    CMD_LEN = 4,
+};
+
+static int alpha, beta, gamma_, delta;
+
+static struct optparse_opt sub_opts[] = {
+    { 'd', "delta", .flag = &delta },
+    { .short_name = END_OF_OPTIONS },
+};
+
+static struct optparse_cmd sub_cmds[] = {
+    { .name = "sub", .options = sub_opts },
+    { .name = END_OF_SUBCOMMANDS },
+};
+
+static struct optparse_opt opts[] = {
+    { 'a', "alpha", .flag = &alpha },
+    { 'b', "beta", .flag = &beta },
+    { 'g', "gamma", .flag = &gamma_ },
+    { .short_name = END_OF_OPTIONS },
+};
+
+static struct optparse_cmd cmd = { .name = "test", .options = opts,
+    .subcommands = sub_cmds };
+
+static unsigned char tree[4096];
+static size_t tree_size;
+
+static uint32_t read_u32(const unsigned char *array, size_t i)
+{
+    uint32_t value;
+    memcpy(&value, array + i * sizeof value, sizeof value);
+    return value;
+}
+
+static void write_u32(unsigned char *array, size_t i, uint32_t value)
+{
+    memcpy(array + i * sizeof value, &value, sizeof value);
+}
+
+// Returns the record of the command with the specified depth-first number.
+static unsigned char *get_record(unsigned char *t, size_t n)
+{
+    return t + read_u32(t, HEADER_CMDS) + n * CMD_LEN * sizeof (uint32_t);
+}
+
+static int n_failed;
+
+// Damages a copy of the compiled tree and checks that it's rejected.
+static void check_damaged(const char *what, void (*damage)(unsigned char *t))
+{
+    static unsigned char copy[sizeof tree];
+    memcpy(copy, tree, tree_size);
+    damage(copy);
+    if (optparse_load_tree(&cmd, copy, tree_size) != -1) {
+        fprintf(stderr, "Damaged compiled tree loaded: %s\n", what);
+        n_failed++;
+    }
+}
+
+// Makes a slot point to an option that doesn't exist.
+static void damage_slot(unsigned char *t)
+{
+    unsigned char *record = get_record(t, 0);
+    write_u32(t + read_u32(t, HEADER_SLOTS), read_u32(record, CMD_SLOTS),
+        0x00100000);
+}
+
+// Fills a command's long option table, so that lookups wouldn't end.
+static void damage_table(unsigned char *t)
+{
+    unsigned char *record = get_record(t, 1);
+    uint32_t first_slot = read_u32(record, CMD_SLOTS);
+    uint32_t n_slots = read_u32(record, CMD_SLOTS_MASK) + 1;
+    for (uint32_t i = first_slot; i < first_slot + n_slots; i++) {
+        write_u32(t + read_u32(t, HEADER_SLOTS), i, 1);
+    }
+}
+
+// Moves the last option's long name beyond the pool.
+static void damage_name_offset(unsigned char *t)
+{
+    write_u32(t + read_u32(t, HEADER_NAME_OFFSETS),
+        read_u32(t, HEADER_N_OPTS) - 1, 0xfffffff0);
+}
+
+// Makes the last option's long name longer than the pool.
+static void damage_name_len(unsigned char *t)
+{
+    write_u32(t + read_u32(t, HEADER_NAME_LENS),
+        read_u32(t, HEADER_N_OPTS) - 1, 0x00100000);
+}
+
+int main(void)
+{
+    tree_size = optparse_compile_tree(&cmd, tree, sizeof tree);
+    if (tree_size == 0 || tree_size > sizeof tree) {
+        fprintf(stderr, "Could not compile the command tree.\n");
+        return EXIT_FAILURE;
+    }
+
+    check_damaged("slot out of range", damage_slot);
+    check_damaged("no empty slot", damage_table);
+    check_damaged("name offset out of range", damage_name_offset);
+    check_damaged("name length out of range", damage_name_len);
+
+    if (optparse_load_tree(&cmd, tree, tree_size) != 0) {
+        fprintf(stderr, "Intact compiled tree not loaded.\n");
+        return EXIT_FAILURE;
+    }
+    char *argv[] = { "test", "--alpha", "-b", "sub", "--delta", NULL };
+    int argc = 5;
+    char **av = argv;
+    struct optparse_ctx ctx = { 0 };
+    optparse_collect_errors(&ctx, NULL, 0);
+    if (optparse_parse_ctx(&ctx, &cmd, &argc, &av) != 0 || !alpha || !beta
+            || gamma_ || !delta) {
+        fprintf(stderr, "Options not found in the loaded compiled tree.\n");
+        n_failed++;
+    }
+
+    printf("%d failures\n", n_failed);
+    return n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
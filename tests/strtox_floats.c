@@ -0,0 +1,153 @@
+// Differential test of strtox() for DATA_TYPE_FLT and DATA_TYPE_DBL: generated
+// strings are converted with strtox() and with strtod() in the "C" locale, and
+// both must agree on the return value and, on success, on every bit of the
+// converted value.
+// Usage: test_strtox_floats [NUMBER_OF_STRINGS]
+
+#include "optparse99.h"
+
+#include <errno.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned long long rng_state = 0x9e3779b97f4a7c15;
+
+// Returns a pseudo-random number (xorshift64).
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Converts a string with strtod(), applying strtox()'s end pointer and range
+// checks, to a double or, if flt is set, to a float.
+// Return value: same as strtox()
+static int convert_strtod(const char *str, void *x, int flt)
+{
+    char *end;
+    errno = 0;
+    double result = strtod(str, &end);
+    if (flt) {
+        if (result < -FLT_MAX || result > FLT_MAX
+                || (result != 0 && (float) result == 0)) {
+            errno = ERANGE;
+        }
+        *(float *) x = (float) result;
+    } else {
+        *(double *) x = result;
+    }
+
+    if (end == str || *end != '\0') {
+        return 1;
+    }
+    return errno == ERANGE ? -1 : 0;
+}
+
+// Writes a random string that looks more or less like a floating-point number
+// to buffer.
+static void generate(char *buffer)
+{
+    static const char *specials[] = { "", ".", "-", "+", "e5", "1e", "1e+",
+        "1.2.3", "--1", "0x1p3", "0X1.8P-1", "inf", "-Infinity", "nan", " 1.5",
+        "1.5 ", "1,5", "1e22", "1e23", "9007199254740992", "9007199254740993",
+        "1.7976931348623157e308", "1.7976931348623159e308", "1e-400",
+        "2.2250738585072014e-308", "4.9e-324", "3.4028235e38", "3.4028236e38",
+        "1e-46", "1.4e-45", "0.000000000000000000000000000001", "-0", "-0.0e0",
+        "123456789012345678901234567890", "0e999999999", "1e-999999999" };
+
+    union {
+        unsigned long long bits;
+        double d;
+    } u;
+
+    switch (rng() % 8) {
+        case 0: // Special cases
+            strcpy(buffer, specials[rng() % (sizeof specials
+                / sizeof specials[0])]);
+            break;
+        case 1: // Any double, as printf() writes it
+        case 2:
+            do {
+                u.bits = rng();
+            } while (u.d != u.d);
+            sprintf(buffer, "%.*g", (int) (rng() % 17) + 1, u.d);
+            break;
+        case 3: // Numbers of modest magnitude, as printf() writes them
+            sprintf(buffer, rng() % 2 ? "%.*f" : "%.*e", (int) (rng() % 20),
+                (double) (rng() % 2000000) / (double) (rng() % 1000 + 1));
+            break;
+        default: // Random digits, decimal point and exponent
+            {
+                char *p = buffer;
+                if (rng() % 4 == 0) {
+                    *p++ = rng() % 2 ? '-' : '+';
+                }
+                int n_digits = (int) (rng() % 25) + (rng() % 8 == 0 ? 0 : 1);
+                int point = rng() % 2 ? (int) (rng() % (n_digits + 1)) : -1;
+                for (int i = 0; i < n_digits; i++) {
+                    if (i == point) {
+                        *p++ = '.';
+                    }
+                    *p++ = rng() % 4 == 0 ? '0' : (char) ('0' + rng() % 10);
+                }
+                if (point == n_digits) {
+                    *p++ = '.';
+                }
+                if (rng() % 2) {
+                    p += sprintf(p, "%c%s%d", rng() % 2 ? 'e' : 'E',
+                        rng() % 2 ? "-" : rng() % 2 ? "+" : "",
+                        (int) (rng() % (rng() % 4 ? 40 : 400)));
+                }
+                *p = '\0';
+            }
+            break;
+    }
+}
+
+static long n_checked, n_failed;
+
+// Converts a string both ways, to float and to double, and reports mismatches.
+static void check(const char *str)
+{
+    for (int flt = 0; flt <= 1; flt++) {
+        char copy[128];
+        strcpy(copy, str);
+        union {
+            float f;
+            double d;
+        } expected = { 0 }, actual = { 0 };
+        int expected_ret = convert_strtod(str, &expected, flt);
+        int actual_ret = strtox(copy, &actual,
+            flt ? DATA_TYPE_FLT : DATA_TYPE_DBL);
+        size_t size = flt ? sizeof (float) : sizeof (double);
+        n_checked++;
+        if (actual_ret != expected_ret
+                || (expected_ret == 0 && memcmp(&actual, &expected, size))) {
+            if (n_failed++ < 20) {
+                fprintf(stderr, "DATA_TYPE_%s \"%s\": strtox() returned %d "
+                    "(value %.17g), strtod() %d (value %.17g)\n",
+                    flt ? "FLT" : "DBL", str, actual_ret,
+                    flt ? actual.f : actual.d, expected_ret,
+                    flt ? expected.f : expected.d);
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long n_strings = argc > 1 ? atol(argv[1]) : 500000;
+
+    char buffer[128];
+    for (long i = 0; i < n_strings; i++) {
+        generate(buffer);
+        check(buffer);
+    }
+
+    printf("%ld conversions, %ld mismatches\n", n_checked, n_failed);
+    return n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
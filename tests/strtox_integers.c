@@ -0,0 +1,264 @@
+// Differential test of strtox() for integer data types: generated strings are
+// converted with strtox() and with the strtol() family, which strtox() used
+// before it got its own parser, and both must agree on the return value and,
+// on success, on the converted value.
+// Usage: test_strtox_integers [NUMBER_OF_STRINGS]
+
+#include "optparse99.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct int_type {
+    enum optparse_data_type data_type;
+    const char *name;
+    long long min;
+    unsigned long long max;
+};
+
+static const struct int_type int_types[] = {
+    { DATA_TYPE_SHRT, "SHRT", SHRT_MIN, SHRT_MAX },
+    { DATA_TYPE_USHRT, "USHRT", 0, USHRT_MAX },
+    { DATA_TYPE_INT, "INT", INT_MIN, INT_MAX },
+    { DATA_TYPE_UINT, "UINT", 0, UINT_MAX },
+    { DATA_TYPE_LONG, "LONG", LONG_MIN, LONG_MAX },
+    { DATA_TYPE_ULONG, "ULONG", 0, ULONG_MAX },
+    { DATA_TYPE_LLONG, "LLONG", LLONG_MIN, LLONG_MAX },
+    { DATA_TYPE_ULLONG, "ULLONG", 0, ULLONG_MAX },
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+    { DATA_TYPE_INT8, "INT8", INT8_MIN, INT8_MAX },
+    { DATA_TYPE_UINT8, "UINT8", 0, UINT8_MAX },
+    { DATA_TYPE_INT16, "INT16", INT16_MIN, INT16_MAX },
+    { DATA_TYPE_UINT16, "UINT16", 0, UINT16_MAX },
+    { DATA_TYPE_INT32, "INT32", INT32_MIN, INT32_MAX },
+    { DATA_TYPE_UINT32, "UINT32", 0, UINT32_MAX },
+    { DATA_TYPE_INT64, "INT64", INT64_MIN, INT64_MAX },
+    { DATA_TYPE_UINT64, "UINT64", 0, UINT64_MAX },
+#endif
+};
+
+#define N_TYPES (sizeof int_types / sizeof int_types[0])
+
+static unsigned long long rng_state = 0x9e3779b97f4a7c15;
+
+// Returns a pseudo-random number (xorshift64).
+static unsigned long long rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Converts a string the way strtox() did with strtol() and friends: signed
+// types through strtoll(), unsigned types through strtoul() or, if they are
+// wider than unsigned long, strtoull(), followed by a range check.
+// Return value: same as strtox(); the value is stored to *value
+static int convert_libc(const char *str, const struct int_type *type,
+    unsigned long long *value)
+{
+    char *end;
+    errno = 0;
+    if (type->min < 0) {
+        long long result = strtoll(str, &end, 0);
+        if (result < type->min || result > (long long) type->max) {
+            errno = ERANGE;
+        }
+        *value = (unsigned long long) result;
+    } else {
+        unsigned long long result = type->max > ULONG_MAX
+            ? strtoull(str, &end, 0) : strtoul(str, &end, 0);
+        if (result > type->max) {
+            errno = ERANGE;
+        }
+        *value = result;
+    }
+
+    if (end == str || *end != '\0') {
+        return 1;
+    }
+    return errno == ERANGE ? -1 : 0;
+}
+
+// Converts a string with strtox(), storing the value as converted by
+// convert_libc().
+static int convert_strtox(char *str, const struct int_type *type,
+    unsigned long long *value)
+{
+    union optparse_data data;
+    int ret = strtox(str, &data, type->data_type);
+    if (ret) {
+        return ret;
+    }
+
+    switch (type->data_type) {
+        case DATA_TYPE_SHRT:
+            *value = data.t_shrt;
+            break;
+        case DATA_TYPE_USHRT:
+            *value = data.t_ushrt;
+            break;
+        case DATA_TYPE_INT:
+            *value = data.t_int;
+            break;
+        case DATA_TYPE_UINT:
+            *value = data.t_uint;
+            break;
+        case DATA_TYPE_LONG:
+            *value = data.t_long;
+            break;
+        case DATA_TYPE_ULONG:
+            *value = data.t_ulong;
+            break;
+        case DATA_TYPE_LLONG:
+            *value = data.t_llong;
+            break;
+        case DATA_TYPE_ULLONG:
+            *value = data.t_ullong;
+            break;
+#if OPTPARSE_C99_INTEGER_TYPES_SUPPORT
+        case DATA_TYPE_INT8:
+            *value = data.t_int8;
+            break;
+        case DATA_TYPE_UINT8:
+            *value = data.t_uint8;
+            break;
+        case DATA_TYPE_INT16:
+            *value = data.t_int16;
+            break;
+        case DATA_TYPE_UINT16:
+            *value = data.t_uint16;
+            break;
+        case DATA_TYPE_INT32:
+            *value = data.t_int32;
+            break;
+        case DATA_TYPE_UINT32:
+            *value = data.t_uint32;
+            break;
+        case DATA_TYPE_INT64:
+            *value = data.t_int64;
+            break;
+        case DATA_TYPE_UINT64:
+            *value = data.t_uint64;
+            break;
+#endif
+        default:
+            break;
+    }
+    return 0;
+}
+
+// Writes a random string that looks more or less like an integer to buffer:
+// optional whitespace, sign and base prefix, up to 25 digits of the base (or
+// of a wrong one), and sometimes a stray character.
+static void generate(char *buffer)
+{
+    static const char *prefixes[] = { "", "", "", "0", "0x", "0X" };
+    static const char *digits[] = { "0123456789", "0123456789abcdefABCDEF",
+        "01234567", "0123456789abcdefghxyzXYZ" };
+    static const char *signs[] = { "", "", "-", "+", "--", "-+" };
+    static const char junk[] = " \t\n.,_+-xX8ge";
+
+    char *p = buffer;
+    for (int n = rng() % 8 == 0 ? (int) (rng() % 3) : 0; n > 0; n--) {
+        *p++ = " \t\n\v\f\r"[rng() % 6];
+    }
+    p += sprintf(p, "%s%s", signs[rng() % 6], prefixes[rng() % 6]);
+
+    const char *charset = digits[rng() % 4];
+    size_t charset_len = strlen(charset);
+    int n_digits = (int) (rng() % 26);
+    for (int i = 0; i < n_digits; i++) {
+        *p++ = charset[rng() % charset_len];
+    }
+    *p = '\0';
+
+    if (rng() % 16 == 0) {
+        size_t len = (size_t) (p - buffer);
+        size_t pos = len ? rng() % (len + 1) : 0;
+        memmove(buffer + pos + 1, buffer + pos, len - pos + 1);
+        buffer[pos] = junk[rng() % (sizeof junk - 1)];
+    }
+}
+
+static long n_checked, n_failed;
+
+// Converts a string both ways, for every integer type, and reports mismatches.
+static void check(const char *str)
+{
+    for (size_t i = 0; i < N_TYPES; i++) {
+        const struct int_type *type = &int_types[i];
+        char copy[64];
+        strcpy(copy, str);
+        unsigned long long expected = 0, actual = 0;
+        int expected_ret = convert_libc(str, type, &expected);
+        int actual_ret = convert_strtox(copy, type, &actual);
+        n_checked++;
+        if (actual_ret != expected_ret
+                || (expected_ret == 0 && actual != expected)) {
+            if (n_failed++ < 20) {
+                fprintf(stderr, "DATA_TYPE_%s \"%s\": strtox() returned %d "
+                    "(value %llu), strtol() family %d (value %llu)\n",
+                    type->name, str, actual_ret, actual, expected_ret,
+                    expected);
+            }
+        }
+    }
+}
+
+// Checks the limits of every type, and the numbers around them, in decimal,
+// hexadecimal and octal notation.
+static void check_limits(void)
+{
+    static const char *extra[] = { "", "0", "0x", "-0", "-0x", "+",
+        "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+        "-9223372036854775809", "18446744073709551615", "18446744073709551616",
+        "-18446744073709551615", "-18446744073709551616",
+        "0xffffffffffffffff", "0x10000000000000000", "01777777777777777777777",
+        "02000000000000000000000", "000000000000000000000000000000000001" };
+    for (size_t i = 0; i < sizeof extra / sizeof extra[0]; i++) {
+        check(extra[i]);
+    }
+
+    char buffer[64];
+    for (size_t i = 0; i < N_TYPES; i++) {
+        const struct int_type *type = &int_types[i];
+        for (int delta = -1; delta <= 1; delta++) {
+            unsigned long long max = type->max + delta;
+            sprintf(buffer, "%llu", max);
+            check(buffer);
+            sprintf(buffer, "0x%llx", max);
+            check(buffer);
+            sprintf(buffer, "0%llo", max);
+            check(buffer);
+            if (type->min < 0) {
+                // The magnitude of min, plus delta.
+                unsigned long long min = (unsigned long long) -(type->min + 1)
+                    + 1 + delta;
+                sprintf(buffer, "-%llu", min);
+                check(buffer);
+                sprintf(buffer, "-0x%llx", min);
+                check(buffer);
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long n_strings = argc > 1 ? atol(argv[1]) : 200000;
+
+    check_limits();
+    char buffer[64];
+    for (long i = 0; i < n_strings; i++) {
+        generate(buffer);
+        check(buffer);
+    }
+
+    printf("%ld conversions, %ld mismatches\n", n_checked, n_failed);
+    return n_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}